@@ -1,4 +1,4 @@
-use std::collections::{HashMap, HashSet};
+use std::collections::HashSet;
 use std::ffi::OsStr;
 use std::fs;
 use std::io::IsTerminal;
@@ -15,11 +15,13 @@ use crossterm::terminal::{
 };
 use crossterm::{execute, ExecutableCommand};
 use dupdupninja_core::db::SqliteScanStore;
+use dupdupninja_core::hash::HashIoBackend;
 use dupdupninja_core::models::ScanRootKind;
 use dupdupninja_core::scan::{
-    prescan, scan_to_sqlite_with_progress_and_totals, PrescanProgress, ScanCancelToken, ScanConfig,
-    ScanProgress, ScanTotals,
+    resume_scan_to_sqlite_with_progress, scan_to_sqlite_with_progress_and_totals, ScanCancelToken,
+    ScanConfig, ScanProgress,
 };
+use dupdupninja_core::similar::{hamming64, snapshot_sequence_distance, BkTree};
 use ratatui::backend::CrosstermBackend;
 use ratatui::layout::{Constraint, Direction, Layout};
 use ratatui::style::{Color, Modifier, Style};
@@ -52,6 +54,8 @@ fn real_main() -> dupdupninja_core::Result<()> {
         }
         "scan" => run_scan_command(&mut args),
         "matches" => run_matches_command(&mut args),
+        "export-index" => run_export_index_command(&mut args),
+        "compare-index" => run_compare_index_command(&mut args),
         "web" => {
             let mut port: u16 = 4455;
             while let Some(arg) = args.next() {
@@ -86,8 +90,10 @@ fn print_help() {
         r#"dupdupninja
 
 USAGE:
-  dupdupninja scan --root <path> [--db <fileset.ddn>] [--drive|--folder] [--single-threaded|--concurrent] [--capture-snapshots|--no-snapshots] [--snapshots-per-video <n>] [--snapshot-max-dim <px>]
-  dupdupninja matches --db <sqlite_path> [--mode <all|similar|exact>] [--tui|--plain] [--max-files <n>] [--ahash <n>] [--dhash <n>] [--phash <n>]
+  dupdupninja scan --root <path> [--db <fileset.ddn>] [--drive|--folder] [--single-threaded|--concurrent] [--capture-snapshots|--no-snapshots] [--snapshots-per-video <n>] [--snapshot-max-dim <px>] [--hash-io <auto|buffered|mmap>] [--lazy-hashing] [--drop-behind] [--incremental] [--resume]
+  dupdupninja matches --db <sqlite_path> [--compare <sqlite_path>] [--mode <all|similar|exact>] [--tui|--plain] [--max-files <n>] [--ahash <n>] [--dhash <n>] [--phash <n>]
+  dupdupninja export-index --db <sqlite_path> --out <index.ddnx>
+  dupdupninja compare-index --a <index.ddnx> --b <index.ddnx>
   dupdupninja web [--port <port>]
 
 NOTES:
@@ -109,6 +115,11 @@ fn run_scan_command(args: &mut impl Iterator<Item = String>) -> dupdupninja_core
     let mut capture_snapshots = false;
     let mut snapshots_per_video: u32 = 3;
     let mut snapshot_max_dim: u32 = 1024;
+    let mut hash_io_backend = HashIoBackend::Auto;
+    let mut lazy_hashing = false;
+    let mut drop_behind_cache = false;
+    let mut incremental = false;
+    let mut resume = false;
 
     while let Some(arg) = args.next() {
         match arg.as_str() {
@@ -131,6 +142,10 @@ fn run_scan_command(args: &mut impl Iterator<Item = String>) -> dupdupninja_core
             "--drive" => root_kind = ScanRootKind::Drive,
             "--folder" => root_kind = ScanRootKind::Folder,
             "--single-threaded" => concurrent_processing = false,
+            "--lazy-hashing" => lazy_hashing = true,
+            "--drop-behind" => drop_behind_cache = true,
+            "--incremental" => incremental = true,
+            "--resume" => resume = true,
             "--concurrent" => concurrent_processing = true,
             "--capture-snapshots" => capture_snapshots = true,
             "--no-snapshots" => capture_snapshots = false,
@@ -146,6 +161,23 @@ fn run_scan_command(args: &mut impl Iterator<Item = String>) -> dupdupninja_core
                     ))
                 })?;
             }
+            "--hash-io" => {
+                let value = args.next().ok_or_else(|| {
+                    dupdupninja_core::Error::InvalidArgument(
+                        "missing value for --hash-io <auto|buffered|mmap>".to_string(),
+                    )
+                })?;
+                hash_io_backend = match value.to_ascii_lowercase().as_str() {
+                    "auto" => HashIoBackend::Auto,
+                    "buffered" => HashIoBackend::Buffered,
+                    "mmap" => HashIoBackend::Mmap,
+                    _ => {
+                        return Err(dupdupninja_core::Error::InvalidArgument(format!(
+                            "invalid --hash-io value: {value} (expected auto|buffered|mmap)"
+                        )));
+                    }
+                };
+            }
             "--snapshot-max-dim" => {
                 let value = args.next().ok_or_else(|| {
                     dupdupninja_core::Error::InvalidArgument(
@@ -190,6 +222,10 @@ fn run_scan_command(args: &mut impl Iterator<Item = String>) -> dupdupninja_core
         snapshots_per_video,
         snapshot_max_dim,
         concurrent_processing,
+        hash_io_backend,
+        lazy_hashing,
+        drop_behind_cache,
+        incremental,
     };
     let snapshots_label = snapshot_settings_label(
         cfg.capture_snapshots,
@@ -229,74 +265,33 @@ fn run_scan_command(args: &mut impl Iterator<Item = String>) -> dupdupninja_core
         println!("snapshots: {snapshots_label}");
     }
 
-    let prescan_result = prescan(&cfg, Some(&cancel_token), |update: &PrescanProgress| {
+    let mut on_update = |update: &ScanProgress| {
         if cancel_token.is_cancelled() {
             ui_state.on_cancel_requested();
         }
         if let Some(ui) = tui.as_mut() {
-            ui_state.on_prescan_progress(update);
+            ui_state.on_scan_progress(update);
             if ui_state.should_render(false) {
                 let _ = ui.render(&ui_state);
             }
         }
         if let Some(progress) = plain_progress.as_mut() {
-            progress.draw_prescan(update);
-        }
-    });
-    let totals = match prescan_result {
-        Ok(totals) => {
-            if let Some(progress) = plain_progress.as_mut() {
-                progress.finish_line();
-            }
-            if let Some(ui) = tui.as_mut() {
-                ui_state.on_prescan_done(totals);
-                let _ = ui.render(&ui_state);
-            } else {
-                println!(
-                    "prescan complete: {} files, {}",
-                    totals.files,
-                    human_bytes(totals.bytes)
-                );
-            }
-            totals
-        }
-        Err(dupdupninja_core::Error::Cancelled) => {
-            cancel_watcher.stop();
-            if let Some(progress) = plain_progress.as_mut() {
-                progress.finish_line();
-            }
-            if let Some(ui) = tui.as_mut() {
-                ui_state.on_cancelled();
-                let _ = ui.render(&ui_state);
-            }
-            drop(tui);
-            println!("scan cancelled during prescan");
-            println!("fileset: {}", db.display());
-            return Ok(());
+            progress.draw_scan(update);
         }
-        Err(err) => return Err(err),
     };
-
-    let result = scan_to_sqlite_with_progress_and_totals(
-        &cfg,
-        &store,
-        Some(&cancel_token),
-        Some(totals),
-        |update: &ScanProgress| {
-            if cancel_token.is_cancelled() {
-                ui_state.on_cancel_requested();
-            }
-            if let Some(ui) = tui.as_mut() {
-                ui_state.on_scan_progress(update);
-                if ui_state.should_render(false) {
-                    let _ = ui.render(&ui_state);
-                }
-            }
-            if let Some(progress) = plain_progress.as_mut() {
-                progress.draw_scan(update);
-            }
-        },
-    );
+    // No separate prescan pass: totals are discovered by the scan's own
+    // walker and grow in ScanProgress as enumeration proceeds.
+    let result = if resume {
+        resume_scan_to_sqlite_with_progress(&cfg, &store, Some(&cancel_token), &mut on_update)
+    } else {
+        scan_to_sqlite_with_progress_and_totals(
+            &cfg,
+            &store,
+            Some(&cancel_token),
+            None,
+            &mut on_update,
+        )
+    };
     if let Some(progress) = plain_progress.as_mut() {
         progress.finish_line();
     }
@@ -314,6 +309,7 @@ fn run_scan_command(args: &mut impl Iterator<Item = String>) -> dupdupninja_core
                 "scan complete: {} files, {} hashed, {} skipped",
                 result.stats.files_seen, result.stats.files_hashed, result.stats.files_skipped
             );
+            print_stage_profile(&result.stats.stage_timings);
             println!("fileset: {}", db.display());
             Ok(())
         }
@@ -411,9 +407,6 @@ struct ScanUiState {
     files_skipped: u64,
     total_files: u64,
     total_bytes: u64,
-    prescan_files: u64,
-    prescan_dirs: u64,
-    prescan_bytes: u64,
     last_render: Instant,
     started_at: Instant,
     visual_mode: VisualMode,
@@ -450,8 +443,8 @@ impl ScanUiState {
             db,
             root_kind,
             snapshots_label,
-            phase: "prescan",
-            current_step: "collecting totals".to_string(),
+            phase: "scan",
+            current_step: "starting".to_string(),
             current_path: PathBuf::new(),
             active_tasks: Vec::new(),
             files_seen: 0,
@@ -459,9 +452,6 @@ impl ScanUiState {
             files_skipped: 0,
             total_files: 0,
             total_bytes: 0,
-            prescan_files: 0,
-            prescan_dirs: 0,
-            prescan_bytes: 0,
             last_render: Instant::now()
                 .checked_sub(Duration::from_millis(250))
                 .unwrap_or_else(Instant::now),
@@ -480,20 +470,6 @@ impl ScanUiState {
         }
     }
 
-    fn on_prescan_progress(&mut self, progress: &PrescanProgress) {
-        self.phase = "prescan";
-        self.current_step = "collecting totals".to_string();
-        self.current_path = progress.current_path.clone();
-        self.prescan_files = progress.files_seen;
-        self.prescan_dirs = progress.dirs_seen;
-        self.prescan_bytes = progress.bytes_seen;
-    }
-
-    fn on_prescan_done(&mut self, totals: ScanTotals) {
-        self.total_files = totals.files;
-        self.total_bytes = totals.bytes;
-    }
-
     fn on_scan_progress(&mut self, progress: &ScanProgress) {
         self.phase = "scan";
         self.current_step = progress
@@ -807,19 +783,11 @@ fn draw_scan_ui(frame: &mut ratatui::Frame<'_>, state: &ScanUiState) {
         ]));
     }
 
-    detail_lines.push(Line::from(vec![
-        Span::styled("Prescan: ", Style::default().fg(Color::Gray)),
-        Span::raw(format!(
-            "files {} | dirs {} | bytes {}",
-            state.prescan_files,
-            state.prescan_dirs,
-            human_bytes(state.prescan_bytes)
-        )),
-    ]));
     detail_lines.push(Line::from(vec![
         Span::styled("Totals: ", Style::default().fg(Color::Gray)),
         Span::raw(format!(
-            "{} | elapsed {}",
+            "{} files | {} | elapsed {}",
+            state.total_files,
             human_bytes(state.total_bytes),
             human_elapsed(state.started_at.elapsed())
         )),
@@ -904,8 +872,7 @@ fn active_task_step_style(step: &str, pretty: bool) -> Style {
         return Style::default();
     }
     match step {
-        "blake3" => Style::default().fg(Color::Rgb(34, 197, 94)),
-        "sha256" => Style::default().fg(Color::Rgb(59, 130, 246)),
+        "hashing" => Style::default().fg(Color::Rgb(34, 197, 94)),
         "ffprobe metadata" => Style::default().fg(Color::Rgb(251, 191, 36)),
         "ahash/dhash/phash" => Style::default().fg(Color::Rgb(244, 114, 182)),
         "video snapshots" => Style::default().fg(Color::Rgb(168, 85, 247)),
@@ -1024,21 +991,6 @@ impl TerminalProgress {
         }
     }
 
-    fn draw_prescan(&mut self, progress: &PrescanProgress) {
-        if !self.should_render(false) {
-            return;
-        }
-        let current = shorten_path(&progress.current_path, 44);
-        let line = format!(
-            "prescan | files {:>8} | dirs {:>7} | bytes {:>10} | {}",
-            progress.files_seen,
-            progress.dirs_seen,
-            human_bytes(progress.bytes_seen),
-            current
-        );
-        self.render_line(&line);
-    }
-
     fn draw_scan(&mut self, progress: &ScanProgress) {
         if !self.should_render(false) {
             return;
@@ -1117,6 +1069,54 @@ fn shorten_path(path: &Path, max: usize) -> String {
     format!("...{tail}")
 }
 
+/// Prints the per-stage scan profile: total and mean time plus an
+/// approximate p90 reconstructed from the log2 histogram buckets. Stages
+/// that never ran are omitted; nothing is printed when no stage ran at
+/// all (for example a metadata-only rescan).
+fn print_stage_profile(timings: &[dupdupninja_core::models::StageTiming]) {
+    let mut stages: Vec<_> = timings.iter().filter(|t| t.calls > 0).collect();
+    if stages.is_empty() {
+        return;
+    }
+    stages.sort_by(|a, b| b.total_micros.cmp(&a.total_micros));
+    println!("stage profile:");
+    for timing in stages {
+        let mean = timing.total_micros / timing.calls;
+        println!(
+            "  {:<18} {:>8} calls  {:>10} total  {:>9} avg  {:>9} p90",
+            timing.stage,
+            timing.calls,
+            human_micros(timing.total_micros),
+            human_micros(mean),
+            human_micros(bucket_percentile(&timing.buckets, timing.calls, 0.90)),
+        );
+    }
+}
+
+/// Upper bound of the bucket containing the given quantile; buckets are
+/// `[2^i, 2^(i+1))` microseconds, so the answer is within 2x of truth.
+fn bucket_percentile(buckets: &[u64], calls: u64, quantile: f64) -> u64 {
+    let rank = ((calls as f64) * quantile).ceil() as u64;
+    let mut seen = 0u64;
+    for (i, count) in buckets.iter().enumerate() {
+        seen += count;
+        if seen >= rank {
+            return 1u64 << (i + 1);
+        }
+    }
+    1u64 << buckets.len()
+}
+
+fn human_micros(micros: u64) -> String {
+    if micros >= 1_000_000 {
+        format!("{:.2}s", micros as f64 / 1_000_000.0)
+    } else if micros >= 1_000 {
+        format!("{:.1}ms", micros as f64 / 1_000.0)
+    } else {
+        format!("{micros}us")
+    }
+}
+
 fn human_bytes(bytes: u64) -> String {
     const KB: f64 = 1024.0;
     const MB: f64 = KB * 1024.0;
@@ -1138,6 +1138,7 @@ fn human_bytes(bytes: u64) -> String {
 
 fn run_matches_command(args: &mut impl Iterator<Item = String>) -> dupdupninja_core::Result<()> {
     let mut db: Option<PathBuf> = None;
+    let mut compare: Option<PathBuf> = None;
     let mut max_files: usize = 500;
     let mut mode = MatchMode::All;
     let mut use_tui: Option<bool> = None;
@@ -1150,6 +1151,7 @@ fn run_matches_command(args: &mut impl Iterator<Item = String>) -> dupdupninja_c
     while let Some(arg) = args.next() {
         match arg.as_str() {
             "--db" => db = args.next().map(PathBuf::from),
+            "--compare" => compare = args.next().map(PathBuf::from),
             "--mode" => {
                 let value = args.next().ok_or_else(|| {
                     dupdupninja_core::Error::InvalidArgument(
@@ -1211,17 +1213,26 @@ fn run_matches_command(args: &mut impl Iterator<Item = String>) -> dupdupninja_c
         dupdupninja_core::Error::InvalidArgument("missing --db <path>".to_string())
     })?;
     let store = SqliteScanStore::open(&db)?;
+
+    if let Some(other) = compare {
+        let comparison = store.compare_with_fileset(&other)?;
+        print_fileset_comparison(&comparison);
+        return Ok(());
+    }
+
     let path_resolver = FilesetPathResolver::from_store(&store);
 
     let load_exact = mode.includes_exact();
     let load_similar = mode.includes_similar();
     let exact = if load_exact {
-        collect_exact_duplicate_groups(&store, max_files)?
+        collect_exact_duplicate_groups(&store)?
     } else {
         Vec::new()
     };
     let similar = if load_similar {
-        collect_similar_groups(&store, max_files, thresholds)?
+        let mut similar = collect_similar_groups(&store, max_files, thresholds)?;
+        similar.extend(collect_video_similar_groups(&store, thresholds)?);
+        similar
     } else {
         Vec::new()
     };
@@ -1267,6 +1278,106 @@ fn run_matches_command(args: &mut impl Iterator<Item = String>) -> dupdupninja_c
     Ok(())
 }
 
+fn run_export_index_command(
+    args: &mut impl Iterator<Item = String>,
+) -> dupdupninja_core::Result<()> {
+    let mut db: Option<PathBuf> = None;
+    let mut out: Option<PathBuf> = None;
+    while let Some(arg) = args.next() {
+        match arg.as_str() {
+            "--db" => db = args.next().map(PathBuf::from),
+            "--out" => out = args.next().map(PathBuf::from),
+            _ => {
+                return Err(dupdupninja_core::Error::InvalidArgument(format!(
+                    "unknown arg: {arg}"
+                )));
+            }
+        }
+    }
+    let db = db.ok_or_else(|| {
+        dupdupninja_core::Error::InvalidArgument("missing --db <path>".to_string())
+    })?;
+    let out = out.ok_or_else(|| {
+        dupdupninja_core::Error::InvalidArgument("missing --out <path>".to_string())
+    })?;
+
+    let store = SqliteScanStore::open(&db)?;
+    let stats = dupdupninja_core::export::export_hash_index(&store, &out)?;
+    println!(
+        "exported hash index: {} rows, {} -> {}",
+        stats.rows,
+        human_bytes(stats.bytes),
+        out.to_string_lossy()
+    );
+    Ok(())
+}
+
+fn run_compare_index_command(
+    args: &mut impl Iterator<Item = String>,
+) -> dupdupninja_core::Result<()> {
+    let mut a: Option<PathBuf> = None;
+    let mut b: Option<PathBuf> = None;
+    while let Some(arg) = args.next() {
+        match arg.as_str() {
+            "--a" => a = args.next().map(PathBuf::from),
+            "--b" => b = args.next().map(PathBuf::from),
+            _ => {
+                return Err(dupdupninja_core::Error::InvalidArgument(format!(
+                    "unknown arg: {arg}"
+                )));
+            }
+        }
+    }
+    let a = a.ok_or_else(|| {
+        dupdupninja_core::Error::InvalidArgument("missing --a <index.ddnx>".to_string())
+    })?;
+    let b = b.ok_or_else(|| {
+        dupdupninja_core::Error::InvalidArgument("missing --b <index.ddnx>".to_string())
+    })?;
+
+    let a = dupdupninja_core::export::HashIndexFile::open(&a)?;
+    let b = dupdupninja_core::export::HashIndexFile::open(&b)?;
+    let comparison = dupdupninja_core::export::compare_hash_indexes(&a, &b);
+    print_fileset_comparison(&comparison);
+    Ok(())
+}
+
+fn print_fileset_comparison(comparison: &dupdupninja_core::models::FilesetComparison) {
+    println!(
+        "Comparing filesets by content hash (blake3):\n  A: {}\n  B: {}",
+        comparison.self_label, comparison.other_label
+    );
+    println!("matched content: {} files", comparison.matched_files);
+    if comparison.self_unhashed > 0 || comparison.other_unhashed > 0 {
+        println!(
+            "unhashed (not comparable): A {} | B {}",
+            comparison.self_unhashed, comparison.other_unhashed
+        );
+    }
+
+    let print_side = |title: &str, rows: &[dupdupninja_core::models::FilesetDiffRow]| {
+        println!("\n{title} ({}):", rows.len());
+        if rows.is_empty() {
+            println!("  (none)");
+            return;
+        }
+        for row in rows {
+            let note = if row.phash_match {
+                " [visually identical file on other side]"
+            } else {
+                ""
+            };
+            println!(
+                "  {} ({}){note}",
+                row.path.to_string_lossy(),
+                human_bytes(row.size_bytes)
+            );
+        }
+    };
+    print_side("Only in A", &comparison.only_in_self);
+    print_side("Only in B", &comparison.only_in_other);
+}
+
 #[derive(Clone, Copy, Debug, PartialEq, Eq)]
 enum MatchMode {
     All,
@@ -1345,59 +1456,22 @@ struct MatchGroup {
 
 fn collect_exact_duplicate_groups(
     store: &SqliteScanStore,
-    max_files: usize,
 ) -> dupdupninja_core::Result<Vec<MatchGroup>> {
-    #[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
-    enum ExactKey {
-        Blake3([u8; 32]),
-        Sha256([u8; 32]),
-    }
-
-    let files = store.list_files(max_files, 0)?;
-    if files.len() == max_files {
-        eprintln!(
-            "warning: reached --max-files limit for exact matching; results may be incomplete"
-        );
-    }
-
-    let mut groups: HashMap<ExactKey, Vec<usize>> = HashMap::new();
-    for (idx, file) in files.iter().enumerate() {
-        let key = if let Some(hash) = file.blake3 {
-            Some(ExactKey::Blake3(hash))
-        } else {
-            file.sha256.map(ExactKey::Sha256)
-        };
-        if let Some(key) = key {
-            groups.entry(key).or_default().push(idx);
-        }
-    }
-
-    let mut group_list: Vec<(ExactKey, Vec<usize>)> = groups
-        .into_iter()
-        .filter(|(_, members)| members.len() > 1)
-        .collect();
-    group_list.sort_by(|a, b| {
-        let a_size =
-            a.1.first()
-                .map(|idx| files[*idx].size_bytes)
-                .unwrap_or_default();
-        let b_size =
-            b.1.first()
-                .map(|idx| files[*idx].size_bytes)
-                .unwrap_or_default();
-        b_size.cmp(&a_size).then_with(|| b.1.len().cmp(&a.1.len()))
-    });
-
+    // Grouping happens in SQL, group at a time, so exact matching covers
+    // the whole fileset regardless of --max-files; only the groups
+    // themselves are held here.
     let mut out = Vec::new();
-    for (key, members) in group_list {
-        let (algo, short_hash) = match key {
-            ExactKey::Blake3(hash) => ("blake3", short_hash_hex(&hash)),
-            ExactKey::Sha256(hash) => ("sha256", short_hash_hex(&hash)),
+    store.for_each_exact_duplicate_group(|rows| {
+        let (algo, short_hash) = if let Some(hash) = rows[0].blake3 {
+            ("blake3", short_hash_hex(&hash))
+        } else if let Some(hash) = rows[0].sha256 {
+            ("sha256", short_hash_hex(&hash))
+        } else {
+            return;
         };
-        let mut entries = Vec::with_capacity(members.len());
+        let mut entries = Vec::with_capacity(rows.len());
         let mut group_size = 0_u64;
-        for member_idx in members {
-            let row = &files[member_idx];
+        for row in rows {
             group_size = row.size_bytes;
             entries.push(match_entry_from_row(row, None));
         }
@@ -1409,7 +1483,12 @@ fn collect_exact_duplicate_groups(
             sort_size_bytes: group_size,
             entries,
         });
-    }
+    })?;
+    out.sort_by(|a, b| {
+        b.sort_size_bytes
+            .cmp(&a.sort_size_bytes)
+            .then_with(|| b.entries.len().cmp(&a.entries.len()))
+    });
     Ok(out)
 }
 
@@ -1425,8 +1504,26 @@ fn collect_similar_groups(
         );
     }
 
+    // One BK-tree per hash kind; candidate generation replaces the old O(n²)
+    // inner sweep, and the exact pairwise check below keeps the semantics.
+    let mut phash_tree = BkTree::new();
+    let mut dhash_tree = BkTree::new();
+    let mut ahash_tree = BkTree::new();
+    for (idx, file) in files.iter().enumerate() {
+        if let Some(hash) = file.phash {
+            phash_tree.insert(hash, idx as u32);
+        }
+        if let Some(hash) = file.dhash {
+            dhash_tree.insert(hash, idx as u32);
+        }
+        if let Some(hash) = file.ahash {
+            ahash_tree.insert(hash, idx as u32);
+        }
+    }
+
     let mut groups: Vec<(usize, Vec<(usize, SimilarityScores)>)> = Vec::new();
     let mut assigned = vec![false; files.len()];
+    let mut hits: Vec<(u32, u32)> = Vec::new();
 
     for i in 0..files.len() {
         if assigned[i] {
@@ -1435,8 +1532,22 @@ fn collect_similar_groups(
         let anchor = &files[i];
         let mut members = Vec::new();
 
-        for j in (i + 1)..files.len() {
-            if assigned[j] {
+        hits.clear();
+        if let Some(hash) = anchor.phash {
+            phash_tree.query(hash, thresholds.phash, &mut hits);
+        }
+        if let Some(hash) = anchor.dhash {
+            dhash_tree.query(hash, thresholds.dhash, &mut hits);
+        }
+        if let Some(hash) = anchor.ahash {
+            ahash_tree.query(hash, thresholds.ahash, &mut hits);
+        }
+        let mut candidates: Vec<usize> = hits.iter().map(|&(id, _)| id as usize).collect();
+        candidates.sort_unstable();
+        candidates.dedup();
+
+        for j in candidates {
+            if j <= i || assigned[j] {
                 continue;
             }
             let scores = similarity_scores(anchor, &files[j]);
@@ -1491,6 +1602,128 @@ fn collect_similar_groups(
     Ok(out)
 }
 
+/// Groups videos whose snapshot hash sequences align closely.
+///
+/// Still-image hashes on the files table never cover videos, so this runs
+/// alongside [`collect_similar_groups`] without overlap: candidates come
+/// from a BK-tree over every stored snapshot phash, and each candidate pair
+/// is verified with the trim-tolerant sequence distance from core.
+fn collect_video_similar_groups(
+    store: &SqliteScanStore,
+    thresholds: SimilarityThresholds,
+) -> dupdupninja_core::Result<Vec<MatchGroup>> {
+    let sequences = store.list_snapshot_phash_sequences()?;
+    if sequences.len() < 2 {
+        return Ok(Vec::new());
+    }
+    let max_mean = thresholds.phash as f64;
+
+    let mut tree = BkTree::new();
+    for (idx, (_, hashes)) in sequences.iter().enumerate() {
+        for &hash in hashes {
+            tree.insert(hash, idx as u32);
+        }
+    }
+
+    let mut groups: Vec<(usize, Vec<(usize, f64)>)> = Vec::new();
+    let mut assigned = vec![false; sequences.len()];
+    let mut hits: Vec<(u32, u32)> = Vec::new();
+
+    for i in 0..sequences.len() {
+        if assigned[i] {
+            continue;
+        }
+        let mut members = Vec::new();
+
+        hits.clear();
+        for &hash in &sequences[i].1 {
+            tree.query(hash, thresholds.phash, &mut hits);
+        }
+        let mut candidates: Vec<usize> = hits.iter().map(|&(id, _)| id as usize).collect();
+        candidates.sort_unstable();
+        candidates.dedup();
+
+        for j in candidates {
+            if j <= i || assigned[j] {
+                continue;
+            }
+            if let Some(mean) = snapshot_sequence_distance(&sequences[i].1, &sequences[j].1) {
+                if mean <= max_mean {
+                    members.push((j, mean));
+                }
+            }
+        }
+
+        if !members.is_empty() {
+            assigned[i] = true;
+            for (member_idx, _) in &members {
+                assigned[*member_idx] = true;
+            }
+            members.sort_by(|a, b| a.1.total_cmp(&b.1));
+            groups.push((i, members));
+        }
+    }
+
+    groups.sort_by(|a, b| b.1.len().cmp(&a.1.len()));
+
+    let mut out = Vec::new();
+    for (anchor_idx, members) in groups {
+        let Some(anchor) = store.get_file_by_id(sequences[anchor_idx].0)? else {
+            continue;
+        };
+        let mut entries = Vec::with_capacity(members.len() + 1);
+        entries.push(match_entry_from_record(
+            &anchor,
+            Some("reference".to_string()),
+        ));
+        let mut best = 0.0_f64;
+        for (member_idx, mean) in members {
+            let Some(member) = store.get_file_by_id(sequences[member_idx].0)? else {
+                continue;
+            };
+            let confidence = ((64.0 - mean) / 64.0 * 100.0).clamp(0.0, 99.99);
+            best = best.max(confidence);
+            entries.push(match_entry_from_record(
+                &member,
+                Some(format!(
+                    "confidence {confidence:.1}% | snapshot mean d {mean:.1}"
+                )),
+            ));
+        }
+        if entries.len() < 2 {
+            continue;
+        }
+        out.push(MatchGroup {
+            kind: MatchGroupKind::Similar,
+            title: format!("video similar {} (best {:.1}%)", entries.len(), best),
+            summary: format!(
+                "{} videos | ref {}",
+                entries.len(),
+                human_bytes(anchor.size_bytes)
+            ),
+            confidence_pct: best.min(99.99),
+            sort_size_bytes: anchor.size_bytes,
+            entries,
+        });
+    }
+    Ok(out)
+}
+
+fn match_entry_from_record(
+    rec: &dupdupninja_core::models::MediaFileRecord,
+    detail: Option<String>,
+) -> MatchEntry {
+    MatchEntry {
+        file_id: rec.file_id.unwrap_or_default(),
+        path: rec.path.clone(),
+        size_bytes: rec.size_bytes,
+        modified_at: rec.modified_at,
+        file_type: rec.file_type.clone(),
+        ffmpeg_metadata: rec.ffmpeg_metadata.clone(),
+        detail,
+    }
+}
+
 fn match_entry_from_row(
     row: &dupdupninja_core::models::FileListRow,
     detail: Option<String>,
@@ -1771,10 +2004,12 @@ impl MatchesUiState {
 
     fn reload_groups(&mut self, store: &SqliteScanStore) -> dupdupninja_core::Result<()> {
         if self.load_exact {
-            self.exact = collect_exact_duplicate_groups(store, self.max_files)?;
+            self.exact = collect_exact_duplicate_groups(store)?;
         }
         if self.load_similar {
             self.similar = collect_similar_groups(store, self.max_files, self.thresholds)?;
+            self.similar
+                .extend(collect_video_similar_groups(store, self.thresholds)?);
         }
         self.expanded.clear();
         self.selected = 0;
@@ -2691,7 +2926,7 @@ fn hash_score(a: Option<u64>, b: Option<u64>) -> Option<HashScore> {
     let (Some(a), Some(b)) = (a, b) else {
         return None;
     };
-    let dist = hamming_distance(a, b);
+    let dist = hamming64(a, b);
     let mut confidence = ((64_u32.saturating_sub(dist)) as f64 / 64.0) * 100.0;
     if confidence >= 100.0 {
         confidence = 99.99;
@@ -2716,7 +2951,3 @@ fn short_hash_hex(hash: &[u8; 32]) -> String {
     }
     out
 }
-
-fn hamming_distance(a: u64, b: u64) -> u32 {
-    (a ^ b).count_ones()
-}
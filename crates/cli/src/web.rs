@@ -1,4 +1,3 @@
-use std::collections::HashMap;
 use std::convert::Infallible;
 use std::path::PathBuf;
 use std::sync::Arc;
@@ -127,8 +126,19 @@ enum ServerEvent {
     MatchesUpdated {
         id: u64,
     },
+    MatchesDelta {
+        id: u64,
+        total_groups: u64,
+        removed: Vec<String>,
+        added: Vec<MatchGroupDto>,
+    },
 }
 
+/// Above this many changed groups the delta payload would dwarf a plain
+/// reload, so the server falls back to `MatchesUpdated` and lets clients
+/// re-fetch.
+const MATCH_DELTA_PUSH_LIMIT: usize = 100;
+
 #[derive(Clone, Debug, Serialize)]
 struct ProgressDto {
     files_seen: u64,
@@ -207,7 +217,7 @@ struct MatchesQuery {
     offset: Option<usize>,
 }
 
-#[derive(Serialize)]
+#[derive(Clone, Debug, Serialize)]
 struct MatchGroupDto {
     key: String,
     files: Vec<FileDto>,
@@ -219,7 +229,7 @@ struct MatchesResponse {
     groups: Vec<MatchGroupDto>,
 }
 
-#[derive(Serialize)]
+#[derive(Clone, Debug, Serialize)]
 struct FileDto {
     id: i64,
     path: String,
@@ -316,10 +326,15 @@ async fn list_matches_handler(
     let limit = query.limit.unwrap_or(200).clamp(1, 2000);
     let offset = query.offset.unwrap_or(0);
 
+    // Served from the persistent match index: grouping ran once when the
+    // index was last refreshed, so concurrent viewers share that work
+    // instead of re-running the duplicate SQL per request. The refresh is
+    // an O(1) counter check when nothing changed.
     let result = tokio::task::spawn_blocking(move || {
         let store = SqliteScanStore::open(&db_path)?;
-        let rows = store.list_files_with_duplicates(limit, offset)?;
-        Ok::<_, Error>(group_matches(rows))
+        store.refresh_match_index()?;
+        let groups = store.list_match_groups(limit, offset)?;
+        Ok::<_, Error>(groups.into_iter().map(match_group_dto).collect::<Vec<_>>())
     })
     .await;
 
@@ -407,6 +422,10 @@ async fn start_scan(state: Arc<AppState>, form: ScanForm) -> Result<()> {
         snapshots_per_video: form.snapshots_per_video.unwrap_or(3).clamp(1, 10),
         snapshot_max_dim: form.snapshot_max_dim.unwrap_or(1024).clamp(128, 4096),
         concurrent_processing: true,
+        hash_io_backend: dupdupninja_core::hash::HashIoBackend::Auto,
+        lazy_hashing: false,
+        drop_behind_cache: false,
+        incremental: false,
     };
 
     let (id, cancel) = {
@@ -477,9 +496,15 @@ async fn start_scan(state: Arc<AppState>, form: ScanForm) -> Result<()> {
                     id,
                     stats: ScanStatsDto::from(&result),
                 });
+                // Refresh the match index while the store is still open and
+                // push the changed groups over SSE; clients patch their view
+                // in place instead of re-fetching the whole match list.
                 let _ = state_for_task
                     .events_tx
-                    .send(ServerEvent::MatchesUpdated { id });
+                    .send(match build_matches_event(&store, id) {
+                        Some(event) => event,
+                        None => ServerEvent::MatchesUpdated { id },
+                    });
             }
             Err(Error::Cancelled) => {
                 update_job(&state_for_task, id, |job| {
@@ -507,6 +532,29 @@ async fn start_scan(state: Arc<AppState>, form: ScanForm) -> Result<()> {
     Ok(())
 }
 
+/// Refreshes the match index after a scan and builds the SSE event that
+/// describes what changed. Returns `None` (caller falls back to a plain
+/// `MatchesUpdated`) when the refresh fails or the delta is too large to
+/// push inline.
+fn build_matches_event(store: &SqliteScanStore, id: u64) -> Option<ServerEvent> {
+    let delta = store.refresh_match_index().ok()??;
+    if delta.added.len() + delta.removed.len() > MATCH_DELTA_PUSH_LIMIT {
+        return None;
+    }
+    let added = store
+        .list_match_groups_for_keys(&delta.added)
+        .ok()?
+        .into_iter()
+        .map(match_group_dto)
+        .collect();
+    Some(ServerEvent::MatchesDelta {
+        id,
+        total_groups: delta.total_groups,
+        removed: delta.removed,
+        added,
+    })
+}
+
 fn update_job<F>(state: &Arc<AppState>, id: u64, f: F)
 where
     F: FnOnce(&mut ScanJob),
@@ -522,43 +570,19 @@ where
     }
 }
 
-fn group_matches(rows: Vec<FileListRow>) -> Vec<MatchGroupDto> {
-    let mut groups: HashMap<String, Vec<FileDto>> = HashMap::new();
-    for row in rows {
-        let key = if let Some(hash) = row.blake3 {
-            format!("blake3:{}", hex_encode(&hash))
-        } else if let Some(hash) = row.sha256 {
-            format!("sha256:{}", hex_encode(&hash))
-        } else {
-            continue;
-        };
-        groups.entry(key).or_default().push(FileDto {
-            id: row.id,
-            path: row.path.display().to_string(),
-            size_bytes: row.size_bytes,
-            file_type: row.file_type,
-        });
-    }
-    let mut out: Vec<MatchGroupDto> = groups
-        .into_iter()
-        .filter_map(|(key, files)| {
-            if files.len() < 2 {
-                None
-            } else {
-                Some(MatchGroupDto { key, files })
-            }
-        })
-        .collect();
-    out.sort_by(|a, b| b.files.len().cmp(&a.files.len()));
-    out
-}
-
-fn hex_encode(bytes: &[u8; 32]) -> String {
-    let mut out = String::with_capacity(64);
-    for byte in bytes {
-        out.push_str(&format!("{:02x}", byte));
+fn match_group_dto((key, rows): (String, Vec<FileListRow>)) -> MatchGroupDto {
+    MatchGroupDto {
+        key,
+        files: rows
+            .into_iter()
+            .map(|row| FileDto {
+                id: row.id,
+                path: row.path.display().to_string(),
+                size_bytes: row.size_bytes,
+                file_type: row.file_type,
+            })
+            .collect(),
     }
-    out
 }
 
 fn scan_db_path(root: &std::path::Path) -> PathBuf {
@@ -709,6 +733,9 @@ function renderJobs(jobs) {
   });
 }
 
+let matchesFilesetId = null;
+const groupEls = new Map();
+
 async function loadMatches(filesetId) {
   if (!filesetId) return;
   const res = await fetch(`/api/filesets/${filesetId}/matches`);
@@ -718,28 +745,58 @@ async function loadMatches(filesetId) {
 }
 
 function renderMatches(groups, filesetId) {
+  matchesFilesetId = filesetId;
+  groupEls.clear();
   matchesContainer.innerHTML = '';
   if (!groups.length) {
     matchesContainer.textContent = 'No duplicates yet.';
     return;
   }
   for (const group of groups) {
-    const wrap = document.createElement('div');
-    wrap.className = 'group';
-    wrap.innerHTML = `<div class="muted">${group.key}</div>`;
-    for (const file of group.files) {
-      const fileRow = document.createElement('div');
-      fileRow.className = 'file';
-      const img = document.createElement('img');
-      img.src = `/api/filesets/${filesetId}/snapshots/${file.id}/0`;
-      img.onerror = () => { img.remove(); };
-      const meta = document.createElement('div');
-      meta.innerHTML = `<div>${file.path}</div><div class="muted">${file.size_bytes} bytes</div>`;
-      fileRow.appendChild(img);
-      fileRow.appendChild(meta);
-      wrap.appendChild(fileRow);
-    }
-    matchesContainer.appendChild(wrap);
+    matchesContainer.appendChild(buildGroupEl(group, filesetId));
+  }
+}
+
+function buildGroupEl(group, filesetId) {
+  const wrap = document.createElement('div');
+  wrap.className = 'group';
+  wrap.innerHTML = `<div class="muted">${group.key}</div>`;
+  for (const file of group.files) {
+    const fileRow = document.createElement('div');
+    fileRow.className = 'file';
+    const img = document.createElement('img');
+    img.src = `/api/filesets/${filesetId}/snapshots/${file.id}/0`;
+    img.onerror = () => { img.remove(); };
+    const meta = document.createElement('div');
+    meta.innerHTML = `<div>${file.path}</div><div class="muted">${file.size_bytes} bytes</div>`;
+    fileRow.appendChild(img);
+    fileRow.appendChild(meta);
+    wrap.appendChild(fileRow);
+  }
+  groupEls.set(group.key, wrap);
+  return wrap;
+}
+
+function applyMatchesDelta(payload) {
+  if (payload.id !== matchesFilesetId) {
+    loadMatches(payload.id);
+    return;
+  }
+  for (const key of payload.removed) {
+    const el = groupEls.get(key);
+    if (el) { el.remove(); groupEls.delete(key); }
+  }
+  if (payload.added.length && !groupEls.size) {
+    matchesContainer.innerHTML = '';
+  }
+  for (const group of payload.added) {
+    const existing = groupEls.get(group.key);
+    const el = buildGroupEl(group, payload.id);
+    if (existing) existing.replaceWith(el);
+    else matchesContainer.prepend(el);
+  }
+  if (!groupEls.size) {
+    matchesContainer.textContent = 'No duplicates yet.';
   }
 }
 
@@ -747,7 +804,10 @@ const source = new EventSource('/events');
 source.onmessage = (event) => {
   try {
     const payload = JSON.parse(event.data);
-    if (payload.type === 'scan_done' || payload.type === 'matches_updated') {
+    if (payload.type === 'matches_delta') {
+      latestFilesetId = payload.id;
+      applyMatchesDelta(payload);
+    } else if (payload.type === 'matches_updated') {
       latestFilesetId = payload.id;
       loadMatches(latestFilesetId);
     }
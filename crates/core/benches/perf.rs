@@ -0,0 +1,302 @@
+//! Criterion suite for the scan hot paths: content hashing across file
+//! size classes, perceptual image hashing, database upsert throughput,
+//! and an end-to-end `scan_to_sqlite` over a synthetic corpus. The
+//! corpus generator is fully deterministic (seeded, no system entropy),
+//! so numbers are comparable across machines and runs.
+//!
+//! Run with `cargo bench -p dupdupninja-core`.
+
+use std::fs::{self, File};
+use std::io::Write;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicU64, Ordering};
+
+use criterion::{criterion_group, criterion_main, BatchSize, BenchmarkId, Criterion, Throughput};
+use dupdupninja_core::db::SqliteScanStore;
+use dupdupninja_core::hash::{blake3_file, sha256_file, HashIoBackend};
+use dupdupninja_core::models::{MediaFileRecord, ScanRootKind};
+use dupdupninja_core::scan::{image_hashes_from_path, scan_to_sqlite, ScanConfig};
+
+use corpus::{CorpusConfig, Xorshift};
+
+/// Scratch directory removed on drop; unique per process so concurrent
+/// bench runs do not collide.
+struct TempDir {
+    path: PathBuf,
+}
+
+impl TempDir {
+    fn new(label: &str) -> Self {
+        let path = std::env::temp_dir().join(format!("ddn-bench-{}-{}", label, std::process::id()));
+        let _ = fs::remove_dir_all(&path);
+        fs::create_dir_all(&path).expect("create bench temp dir");
+        Self { path }
+    }
+}
+
+impl Drop for TempDir {
+    fn drop(&mut self) {
+        let _ = fs::remove_dir_all(&self.path);
+    }
+}
+
+fn size_label(size: u64) -> String {
+    if size >= 1024 * 1024 {
+        format!("{}MiB", size / (1024 * 1024))
+    } else {
+        format!("{}KiB", size / 1024)
+    }
+}
+
+fn write_deterministic_file(path: &Path, size: u64, seed: u64) {
+    let mut rng = Xorshift::new(seed);
+    let mut file = File::create(path).expect("create bench file");
+    let mut remaining = size as usize;
+    let mut buf = [0u8; 8192];
+    while remaining > 0 {
+        rng.fill(&mut buf);
+        let take = remaining.min(buf.len());
+        file.write_all(&buf[..take]).expect("write bench file");
+        remaining -= take;
+    }
+}
+
+/// `blake3_file` / `sha256_file` across size classes: small files are
+/// dominated by open/stat overhead, large ones by hash throughput.
+fn bench_content_hashing(c: &mut Criterion) {
+    let dir = TempDir::new("hash");
+    let mut group = c.benchmark_group("content_hashing");
+    for &size in &[4 * 1024u64, 256 * 1024, 16 * 1024 * 1024] {
+        let path = dir.path.join(format!("{size}.bin"));
+        write_deterministic_file(&path, size, size);
+        group.throughput(Throughput::Bytes(size));
+        group.bench_with_input(
+            BenchmarkId::new("blake3_file", size_label(size)),
+            &path,
+            |b, path| b.iter(|| blake3_file(path).unwrap()),
+        );
+        group.bench_with_input(
+            BenchmarkId::new("sha256_file", size_label(size)),
+            &path,
+            |b, path| b.iter(|| sha256_file(path).unwrap()),
+        );
+    }
+    group.finish();
+}
+
+/// Perceptual hashing of a decoded image: measures decode + the three
+/// hash passes together, matching what the scan pays per image file.
+fn bench_image_hashes(c: &mut Criterion) {
+    let dir = TempDir::new("img");
+    let path = dir.path.join("noise.png");
+    let mut rng = Xorshift::new(0x1a6e);
+    let mut img = image::RgbImage::new(1024, 768);
+    for pixel in img.pixels_mut() {
+        let v = rng.next();
+        *pixel = image::Rgb([v as u8, (v >> 8) as u8, (v >> 16) as u8]);
+    }
+    img.save(&path).expect("save bench png");
+
+    c.bench_function("image_hashes_from_path/1024x768_png", |b| {
+        b.iter(|| image_hashes_from_path(&path).unwrap())
+    });
+}
+
+fn bench_record(index: u64) -> MediaFileRecord {
+    let mut rng = Xorshift::new(index + 1);
+    let mut blake3 = [0u8; 32];
+    rng.fill(&mut blake3);
+    MediaFileRecord {
+        file_id: None,
+        path: PathBuf::from(format!("bench/file-{index:06}.bin")),
+        size_bytes: 1024 + index,
+        modified_at: None,
+        blake3: Some(blake3),
+        sha256: None,
+        sample_hash: None,
+        ahash: Some(rng.next()),
+        dhash: Some(rng.next()),
+        phash: Some(rng.next()),
+        ffmpeg_metadata: None,
+        file_type: Some("application/octet-stream".to_string()),
+    }
+}
+
+/// Upsert throughput into a fresh database: the one-row prepared
+/// statement versus the multi-row batch form the scan flush uses.
+fn bench_db_upsert(c: &mut Criterion) {
+    const ROWS: u64 = 1000;
+    let dir = TempDir::new("db");
+    let db_seq = AtomicU64::new(0);
+    let fresh_store = || {
+        let seq = db_seq.fetch_add(1, Ordering::Relaxed);
+        let store = SqliteScanStore::open(&dir.path.join(format!("bench-{seq}.ddn")))
+            .expect("open bench db");
+        let recs: Vec<MediaFileRecord> = (0..ROWS).map(bench_record).collect();
+        (store, recs)
+    };
+
+    let mut group = c.benchmark_group("db_upsert");
+    group.throughput(Throughput::Elements(ROWS));
+    group.bench_function(BenchmarkId::new("upsert_file", ROWS), |b| {
+        b.iter_batched(
+            fresh_store,
+            |(store, recs)| {
+                for rec in &recs {
+                    store.upsert_file(rec).unwrap();
+                }
+            },
+            BatchSize::PerIteration,
+        )
+    });
+    group.bench_function(BenchmarkId::new("upsert_files_batch", ROWS), |b| {
+        b.iter_batched(
+            fresh_store,
+            |(store, recs)| store.upsert_files_batch(&recs).unwrap(),
+            BatchSize::PerIteration,
+        )
+    });
+    group.finish();
+}
+
+/// End-to-end scan of a deterministic synthetic corpus into a fresh
+/// database: walk, hashing, duplicate detection and SQLite writes
+/// together, with throughput reported in corpus bytes.
+fn bench_scan_to_sqlite(c: &mut Criterion) {
+    let corpus_dir = TempDir::new("corpus");
+    let cfg = CorpusConfig {
+        files: 400,
+        size_classes: &[1024, 16 * 1024, 256 * 1024],
+        duplicate_ratio: 0.3,
+        seed: 0x5ca7_c0de,
+    };
+    let total_bytes = corpus::generate(&cfg, &corpus_dir.path);
+
+    let db_dir = TempDir::new("scandb");
+    let db_seq = AtomicU64::new(0);
+
+    let mut group = c.benchmark_group("scan_to_sqlite");
+    group.sample_size(10);
+    group.throughput(Throughput::Bytes(total_bytes));
+    group.bench_function(BenchmarkId::new("400files", "dup30pct"), |b| {
+        b.iter_batched(
+            || {
+                let seq = db_seq.fetch_add(1, Ordering::Relaxed);
+                db_dir.path.join(format!("scan-{seq}.ddn"))
+            },
+            |db_path| {
+                let store = SqliteScanStore::open(&db_path).expect("open scan db");
+                let scan_cfg = ScanConfig {
+                    root: corpus_dir.path.clone(),
+                    root_kind: ScanRootKind::Folder,
+                    hash_files: true,
+                    perceptual_hashes: false,
+                    capture_snapshots: false,
+                    snapshots_per_video: 1,
+                    snapshot_max_dim: 256,
+                    concurrent_processing: true,
+                    hash_io_backend: HashIoBackend::Auto,
+                    lazy_hashing: false,
+                    drop_behind_cache: false,
+                    incremental: false,
+                };
+                scan_to_sqlite(&scan_cfg, &store).expect("bench scan")
+            },
+            BatchSize::PerIteration,
+        )
+    });
+    group.finish();
+}
+
+/// Deterministic synthetic corpus generation: file count, size
+/// distribution and duplicate ratio are all explicit, and everything
+/// derives from one seed so two machines build byte-identical trees.
+mod corpus {
+    use std::fs::File;
+    use std::io::Write;
+    use std::path::Path;
+
+    pub struct CorpusConfig {
+        /// Total number of files to generate.
+        pub files: usize,
+        /// File sizes cycle through these classes round-robin.
+        pub size_classes: &'static [u64],
+        /// Fraction of files written as exact copies of an earlier file,
+        /// so the scan's duplicate grouping has real work to do.
+        pub duplicate_ratio: f64,
+        pub seed: u64,
+    }
+
+    /// xorshift64* — tiny, seedable, and identical everywhere, which is
+    /// the point: no `rand` version or OS entropy anywhere in the loop.
+    pub struct Xorshift(u64);
+
+    impl Xorshift {
+        pub fn new(seed: u64) -> Self {
+            Self(seed.max(1))
+        }
+
+        pub fn next(&mut self) -> u64 {
+            let mut x = self.0;
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            self.0 = x;
+            x.wrapping_mul(0x2545_f491_4f6c_dd1d)
+        }
+
+        pub fn fill(&mut self, buf: &mut [u8]) {
+            for chunk in buf.chunks_mut(8) {
+                let v = self.next().to_le_bytes();
+                chunk.copy_from_slice(&v[..chunk.len()]);
+            }
+        }
+    }
+
+    /// Writes the corpus under `dir` and returns its total size in
+    /// bytes. Duplicates reuse the content seed of an earlier unique
+    /// file, so their bytes match exactly without rereading it.
+    pub fn generate(cfg: &CorpusConfig, dir: &Path) -> u64 {
+        let mut rng = Xorshift::new(cfg.seed);
+        let dup_threshold = (cfg.duplicate_ratio * u64::MAX as f64) as u64;
+        // (size, content seed) per unique file, so duplicates can pick one.
+        let mut uniques: Vec<(u64, u64)> = Vec::new();
+        let mut total = 0u64;
+        for index in 0..cfg.files {
+            let (size, content_seed) = if !uniques.is_empty() && rng.next() < dup_threshold {
+                uniques[rng.next() as usize % uniques.len()]
+            } else {
+                let size = cfg.size_classes[index % cfg.size_classes.len()];
+                let seed = rng.next();
+                uniques.push((size, seed));
+                (size, seed)
+            };
+            let path = dir.join(format!("f{index:06}.bin"));
+            write_file(&path, size, content_seed);
+            total += size;
+        }
+        total
+    }
+
+    fn write_file(path: &Path, size: u64, seed: u64) {
+        let mut rng = Xorshift::new(seed);
+        let mut file = File::create(path).expect("create corpus file");
+        let mut remaining = size as usize;
+        let mut buf = [0u8; 8192];
+        while remaining > 0 {
+            rng.fill(&mut buf);
+            let take = remaining.min(buf.len());
+            file.write_all(&buf[..take]).expect("write corpus file");
+            remaining -= take;
+        }
+    }
+}
+
+criterion_group!(
+    benches,
+    bench_content_hashing,
+    bench_image_hashes,
+    bench_db_upsert,
+    bench_scan_to_sqlite
+);
+criterion_main!(benches);
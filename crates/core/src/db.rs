@@ -1,11 +1,14 @@
-use std::path::Path;
+use std::collections::HashMap;
+use std::path::{Path, PathBuf};
 use std::time::{Duration, SystemTime, UNIX_EPOCH};
 
-use rusqlite::{params, Connection, OptionalExtension};
+use rusqlite::types::Value;
+use rusqlite::{params, params_from_iter, Connection, DatabaseName, OptionalExtension};
 
-use crate::error::Result;
+use crate::error::{Error, Result};
 use crate::models::{
-    DriveMetadata, FileListRow, FileSnapshotRecord, FilesetMetadata, MediaFileRecord, ScanRootKind,
+    DriveMetadata, FileListRow, FileSnapshotRecord, FilesetComparison, FilesetDiffRow,
+    FilesetMetadata, MatchIndexDelta, MediaFileRecord, ScanRootKind,
 };
 
 pub struct SqliteScanStore {
@@ -16,6 +19,19 @@ pub struct SqliteScanStore {
 impl SqliteScanStore {
     pub fn open(path: &Path) -> Result<Self> {
         let conn = Connection::open(path)?;
+        // Connection-wide profile for scan-sized workloads: WAL so readers
+        // never block the writer, relaxed fsync cadence, a 64 MiB page cache
+        // and a 256 MiB mmap window so index probes and blob reads hit mapped
+        // pages instead of read() calls. Harmless for small filesets.
+        conn.execute_batch(
+            r#"
+            PRAGMA journal_mode = WAL;
+            PRAGMA synchronous = NORMAL;
+            PRAGMA temp_store = MEMORY;
+            PRAGMA cache_size = -65536;
+            PRAGMA mmap_size = 268435456;
+            "#,
+        )?;
         let store = Self {
             conn,
             has_file_id: false,
@@ -58,6 +74,7 @@ impl SqliteScanStore {
               modified_at_secs INTEGER,
               blake3 BLOB,
               sha256 BLOB,
+              sample_hash BLOB,
               ahash INTEGER,
               dhash INTEGER,
               phash INTEGER,
@@ -83,12 +100,95 @@ impl SqliteScanStore {
               image_avif BLOB NOT NULL,
               PRIMARY KEY (file_id, snapshot_index),
               FOREIGN KEY(file_id) REFERENCES files(id) ON DELETE CASCADE
-            ) WITHOUT ROWID;
+            );
 
             CREATE INDEX IF NOT EXISTS idx_file_snapshots_file_id ON file_snapshots(file_id);
+
+            CREATE TABLE IF NOT EXISTS match_index (
+              group_key TEXT NOT NULL,
+              file_id INTEGER NOT NULL,
+              PRIMARY KEY (group_key, file_id)
+            ) WITHOUT ROWID;
+
+            CREATE TABLE IF NOT EXISTS match_index_state (
+              id INTEGER PRIMARY KEY NOT NULL CHECK (id = 1),
+              change_counter INTEGER NOT NULL,
+              indexed_counter INTEGER NOT NULL
+            );
+
+            INSERT OR IGNORE INTO match_index_state (id, change_counter, indexed_counter)
+            VALUES (1, 1, 0);
             "#,
         )?;
+        // Recreating a missing staleness trigger also bumps the change
+        // counter, so a scan interrupted while the triggers were deferred
+        // cannot leave the index looking fresh after reopen.
+        let triggers: i64 = self.conn.query_row(
+            r#"
+            SELECT COUNT(*) FROM sqlite_master
+            WHERE type = 'trigger' AND name IN (
+              'trg_match_index_files_insert',
+              'trg_match_index_files_update',
+              'trg_match_index_files_delete'
+            )
+            "#,
+            [],
+            |r| r.get(0),
+        )?;
+        if triggers < 3 {
+            self.ensure_match_index_triggers()?;
+        }
         self.ensure_hash_columns()?;
+        self.ensure_snapshots_rowid_table()?;
+        Ok(())
+    }
+
+    /// Rebuilds `file_snapshots` as an ordinary rowid table when an older
+    /// database created it `WITHOUT ROWID`. SQLite's incremental blob I/O
+    /// (behind [`SqliteScanStore::read_snapshot_blob_at`]) only works on
+    /// rowid tables, so existing filesets pay a one-time copy here in
+    /// exchange for zero-copy snapshot reads afterwards.
+    fn ensure_snapshots_rowid_table(&self) -> Result<()> {
+        let sql: Option<String> = self
+            .conn
+            .query_row(
+                "SELECT sql FROM sqlite_master WHERE type = 'table' AND name = 'file_snapshots'",
+                [],
+                |r| r.get(0),
+            )
+            .optional()?;
+        let Some(sql) = sql else {
+            return Ok(());
+        };
+        if !sql.to_ascii_uppercase().contains("WITHOUT ROWID") {
+            return Ok(());
+        }
+        self.conn.execute_batch(
+            r#"
+            BEGIN;
+            CREATE TABLE file_snapshots_rowid (
+              file_id INTEGER NOT NULL,
+              snapshot_index INTEGER NOT NULL,
+              snapshot_count INTEGER NOT NULL,
+              at_ms INTEGER NOT NULL,
+              duration_ms INTEGER,
+              ahash INTEGER,
+              dhash INTEGER,
+              phash INTEGER,
+              image_avif BLOB NOT NULL,
+              PRIMARY KEY (file_id, snapshot_index),
+              FOREIGN KEY(file_id) REFERENCES files(id) ON DELETE CASCADE
+            );
+            INSERT INTO file_snapshots_rowid
+              SELECT file_id, snapshot_index, snapshot_count, at_ms, duration_ms,
+                     ahash, dhash, phash, image_avif
+              FROM file_snapshots;
+            DROP TABLE file_snapshots;
+            ALTER TABLE file_snapshots_rowid RENAME TO file_snapshots;
+            CREATE INDEX IF NOT EXISTS idx_file_snapshots_file_id ON file_snapshots(file_id);
+            COMMIT;
+            "#,
+        )?;
         Ok(())
     }
 
@@ -113,6 +213,7 @@ impl SqliteScanStore {
     }
 
     fn ensure_hash_columns(&self) -> Result<()> {
+        self.ensure_column("files", "sample_hash", "BLOB")?;
         self.ensure_column("files", "ahash", "INTEGER")?;
         self.ensure_column("files", "dhash", "INTEGER")?;
         self.ensure_column("files", "phash", "INTEGER")?;
@@ -144,61 +245,45 @@ impl SqliteScanStore {
     }
 
     pub fn upsert_file(&self, rec: &MediaFileRecord) -> Result<i64> {
-        let modified_at_secs = rec.modified_at.map(system_time_to_secs).map(|v| v as i64);
-
-        let blake3_bytes: Option<Vec<u8>> = rec.blake3.map(|b| b.to_vec());
-        let sha256_bytes: Option<Vec<u8>> = rec.sha256.map(|b| b.to_vec());
-        let ahash = rec.ahash.map(|v| v as i64);
-        let dhash = rec.dhash.map(|v| v as i64);
-        let phash = rec.phash.map(|v| v as i64);
+        let mut stmt = self.conn.prepare_cached(&files_upsert_sql(1))?;
+        stmt.execute(params_from_iter(file_row_values(rec)))?;
 
-        self.conn.execute(
-            r#"
-            INSERT INTO files (
-              path, size_bytes, modified_at_secs, blake3, sha256, ahash, dhash, phash, ffmpeg_metadata, file_type
-            ) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10)
-            ON CONFLICT(path) DO UPDATE SET
-              size_bytes=excluded.size_bytes,
-              modified_at_secs=excluded.modified_at_secs,
-              blake3=excluded.blake3,
-              sha256=excluded.sha256,
-              ahash=excluded.ahash,
-              dhash=excluded.dhash,
-              phash=excluded.phash,
-              ffmpeg_metadata=excluded.ffmpeg_metadata,
-              file_type=excluded.file_type
-            "#,
-            params![
-                rec.path.to_string_lossy(),
-                rec.size_bytes as i64,
-                modified_at_secs,
-                blake3_bytes,
-                sha256_bytes,
-                ahash,
-                dhash,
-                phash,
-                rec.ffmpeg_metadata.as_deref(),
-                rec.file_type.as_deref(),
-            ],
-        )?;
         let id_col = self.file_id_column();
         let sql = format!("SELECT {id_col} FROM files WHERE path = ?1");
-        let file_id = self
-            .conn
-            .query_row(&sql, params![rec.path.to_string_lossy()], |r| {
-                r.get::<_, i64>(0)
-            })?;
+        let mut stmt = self.conn.prepare_cached(&sql)?;
+        let file_id =
+            stmt.query_row(params![rec.path.to_string_lossy()], |r| r.get::<_, i64>(0))?;
         Ok(file_id)
     }
 
+    /// Upserts many records with multi-row prepared statements, avoiding one
+    /// statement round trip per file. Use this for records that do not need
+    /// their row id back; [`upsert_file`] returns the id for callers that do.
+    pub fn upsert_files_batch(&self, recs: &[MediaFileRecord]) -> Result<()> {
+        // A fixed chunk width keeps the statement cacheable; the tail falls
+        // back to the single-row form, which is cached too.
+        const ROWS_PER_INSERT: usize = 8;
+
+        let mut chunks = recs.chunks_exact(ROWS_PER_INSERT);
+        let multi_sql = files_upsert_sql(ROWS_PER_INSERT);
+        for chunk in chunks.by_ref() {
+            let mut stmt = self.conn.prepare_cached(&multi_sql)?;
+            stmt.execute(params_from_iter(chunk.iter().flat_map(file_row_values)))?;
+        }
+        let single_sql = files_upsert_sql(1);
+        for rec in chunks.remainder() {
+            let mut stmt = self.conn.prepare_cached(&single_sql)?;
+            stmt.execute(params_from_iter(file_row_values(rec)))?;
+        }
+        Ok(())
+    }
+
     pub fn begin_scan_write_optimized_tx(&self) -> Result<()> {
-        // Favor fewer fsyncs and larger in-memory work buffers while scanning.
+        // The journal/cache profile is applied once in open(); per
+        // transaction we only keep the WAL from growing unbounded between
+        // the scan's periodic commits.
         self.conn.execute_batch(
             r#"
-            PRAGMA journal_mode = WAL;
-            PRAGMA synchronous = NORMAL;
-            PRAGMA temp_store = MEMORY;
-            PRAGMA cache_size = -32768;
             PRAGMA wal_autocheckpoint = 2000;
             BEGIN IMMEDIATE;
             "#,
@@ -206,6 +291,79 @@ impl SqliteScanStore {
         Ok(())
     }
 
+    /// Drops the hash lookup indexes so bulk inserts do not pay four index
+    /// updates per row. Call [`ensure_hash_indexes`](Self::ensure_hash_indexes)
+    /// once the scan finishes; a plain [`open`](Self::open) also recreates
+    /// them, so an interrupted scan leaves nothing permanently missing.
+    pub fn defer_hash_indexes(&self) -> Result<()> {
+        self.conn.execute_batch(
+            r#"
+            DROP INDEX IF EXISTS idx_files_blake3;
+            DROP INDEX IF EXISTS idx_files_ahash;
+            DROP INDEX IF EXISTS idx_files_dhash;
+            DROP INDEX IF EXISTS idx_files_phash;
+            "#,
+        )?;
+        Ok(())
+    }
+
+    /// Builds the hash lookup indexes in one pass over the table, which is
+    /// far cheaper than maintaining them row by row during a bulk scan.
+    pub fn ensure_hash_indexes(&self) -> Result<()> {
+        self.conn.execute_batch(
+            r#"
+            CREATE INDEX IF NOT EXISTS idx_files_blake3 ON files(blake3);
+            CREATE INDEX IF NOT EXISTS idx_files_ahash ON files(ahash);
+            CREATE INDEX IF NOT EXISTS idx_files_dhash ON files(dhash);
+            CREATE INDEX IF NOT EXISTS idx_files_phash ON files(phash);
+            "#,
+        )?;
+        Ok(())
+    }
+
+    /// Drops the match-index staleness triggers so bulk `files` writes do
+    /// not each run a trigger program against `match_index_state`. Call
+    /// [`ensure_match_index_triggers`](Self::ensure_match_index_triggers)
+    /// once the scan finishes; a plain [`open`](Self::open) also recreates
+    /// them (bumping the counter), so an interrupted scan leaves nothing
+    /// permanently missing.
+    pub fn defer_match_index_triggers(&self) -> Result<()> {
+        self.conn.execute_batch(
+            r#"
+            DROP TRIGGER IF EXISTS trg_match_index_files_insert;
+            DROP TRIGGER IF EXISTS trg_match_index_files_update;
+            DROP TRIGGER IF EXISTS trg_match_index_files_delete;
+            "#,
+        )?;
+        Ok(())
+    }
+
+    /// Recreates the match-index staleness triggers and bumps the change
+    /// counter once, covering everything written while they were deferred.
+    pub fn ensure_match_index_triggers(&self) -> Result<()> {
+        self.conn.execute_batch(
+            r#"
+            CREATE TRIGGER IF NOT EXISTS trg_match_index_files_insert
+            AFTER INSERT ON files BEGIN
+              UPDATE match_index_state SET change_counter = change_counter + 1;
+            END;
+
+            CREATE TRIGGER IF NOT EXISTS trg_match_index_files_update
+            AFTER UPDATE OF blake3, sha256 ON files BEGIN
+              UPDATE match_index_state SET change_counter = change_counter + 1;
+            END;
+
+            CREATE TRIGGER IF NOT EXISTS trg_match_index_files_delete
+            AFTER DELETE ON files BEGIN
+              UPDATE match_index_state SET change_counter = change_counter + 1;
+            END;
+
+            UPDATE match_index_state SET change_counter = change_counter + 1;
+            "#,
+        )?;
+        Ok(())
+    }
+
     pub fn commit_tx(&self) -> Result<()> {
         self.conn.execute_batch("COMMIT")?;
         Ok(())
@@ -221,30 +379,30 @@ impl SqliteScanStore {
         file_id: i64,
         snapshots: &[FileSnapshotRecord],
     ) -> Result<()> {
-        self.conn.execute(
-            r#"DELETE FROM file_snapshots WHERE file_id = ?1"#,
-            params![file_id],
-        )?;
+        let mut delete = self
+            .conn
+            .prepare_cached(r#"DELETE FROM file_snapshots WHERE file_id = ?1"#)?;
+        delete.execute(params![file_id])?;
 
         for snap in snapshots {
-            self.conn.execute(
+            let mut insert = self.conn.prepare_cached(
                 r#"
                 INSERT INTO file_snapshots (
                   file_id, snapshot_index, snapshot_count, at_ms, duration_ms, ahash, dhash, phash, image_avif
                 ) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9)
                 "#,
-                params![
-                    file_id,
-                    snap.snapshot_index as i64,
-                    snap.snapshot_count as i64,
-                    snap.at_ms,
-                    snap.duration_ms,
-                    snap.ahash.map(|v| v as i64),
-                    snap.dhash.map(|v| v as i64),
-                    snap.phash.map(|v| v as i64),
-                    &snap.image_avif,
-                ],
             )?;
+            insert.execute(params![
+                file_id,
+                snap.snapshot_index as i64,
+                snap.snapshot_count as i64,
+                snap.at_ms,
+                snap.duration_ms,
+                snap.ahash.map(|v| v as i64),
+                snap.dhash.map(|v| v as i64),
+                snap.phash.map(|v| v as i64),
+                &snap.image_avif,
+            ])?;
         }
         Ok(())
     }
@@ -462,6 +620,445 @@ impl SqliteScanStore {
         Ok(out)
     }
 
+    /// Streams exact-duplicate groups straight out of SQL, one group at a
+    /// time, with no row cap: grouping is `GROUP BY blake3 HAVING
+    /// COUNT(*) > 1` (driven by `idx_files_blake3`), with a second pass
+    /// grouping rows that have no blake3 by sha256, matching the key
+    /// fallback the CLI has always used. Rows arrive ordered by group key
+    /// so each group is contiguous; `on_group` sees one group's rows at a
+    /// time and memory stays proportional to the largest group, not the
+    /// fileset.
+    pub fn for_each_exact_duplicate_group<F>(&self, mut on_group: F) -> Result<()>
+    where
+        F: FnMut(&[FileListRow]),
+    {
+        let id_col = self.file_id_column();
+        let blake3_sql = format!(
+            r#"
+            SELECT f.{id_col} AS id, f.path, f.size_bytes, f.modified_at_secs, f.blake3, f.sha256, f.ahash, f.dhash, f.phash, f.ffmpeg_metadata, f.file_type
+            FROM files f
+            JOIN (
+              SELECT blake3 FROM files
+              WHERE blake3 IS NOT NULL
+              GROUP BY blake3 HAVING COUNT(*) > 1
+            ) dup ON f.blake3 = dup.blake3
+            ORDER BY f.blake3, f.path
+            "#
+        );
+        self.stream_duplicate_groups(&blake3_sql, |row| row.blake3, &mut on_group)?;
+
+        let sha256_sql = format!(
+            r#"
+            SELECT f.{id_col} AS id, f.path, f.size_bytes, f.modified_at_secs, f.blake3, f.sha256, f.ahash, f.dhash, f.phash, f.ffmpeg_metadata, f.file_type
+            FROM files f
+            JOIN (
+              SELECT sha256 FROM files
+              WHERE blake3 IS NULL AND sha256 IS NOT NULL
+              GROUP BY sha256 HAVING COUNT(*) > 1
+            ) dup ON f.sha256 = dup.sha256
+            WHERE f.blake3 IS NULL
+            ORDER BY f.sha256, f.path
+            "#
+        );
+        self.stream_duplicate_groups(&sha256_sql, |row| row.sha256, &mut on_group)?;
+        Ok(())
+    }
+
+    /// Runs `sql` (rows ordered so equal group keys are adjacent) and
+    /// invokes `on_group` for every contiguous run sharing a key, reusing
+    /// one buffer across groups.
+    fn stream_duplicate_groups<K, F>(&self, sql: &str, key: K, on_group: &mut F) -> Result<()>
+    where
+        K: Fn(&FileListRow) -> Option<[u8; 32]>,
+        F: FnMut(&[FileListRow]),
+    {
+        let mut stmt = self.conn.prepare(sql)?;
+        let rows = stmt.query_map([], |r| {
+            let modified_at_secs: Option<i64> = r.get(3)?;
+            let blake3: Option<Vec<u8>> = r.get(4)?;
+            let sha256: Option<Vec<u8>> = r.get(5)?;
+            let ahash: Option<i64> = r.get(6)?;
+            let dhash: Option<i64> = r.get(7)?;
+            let phash: Option<i64> = r.get(8)?;
+            Ok(FileListRow {
+                id: r.get(0)?,
+                path: Path::new(r.get::<_, String>(1)?.as_str()).to_path_buf(),
+                size_bytes: r.get::<_, i64>(2)? as u64,
+                modified_at: modified_at_secs.map(|v| secs_to_system_time(v.max(0) as u64)),
+                blake3: blob_to_hash(blake3),
+                sha256: blob_to_hash(sha256),
+                ahash: ahash.map(|v| v as u64),
+                dhash: dhash.map(|v| v as u64),
+                phash: phash.map(|v| v as u64),
+                ffmpeg_metadata: r.get(9)?,
+                file_type: r.get(10)?,
+            })
+        })?;
+
+        let mut group: Vec<FileListRow> = Vec::new();
+        let mut group_key: Option<[u8; 32]> = None;
+        for row in rows {
+            let row = row?;
+            let row_key = key(&row);
+            if group_key.is_some() && row_key != group_key {
+                if group.len() > 1 {
+                    on_group(&group);
+                }
+                group.clear();
+            }
+            group_key = row_key;
+            group.push(row);
+        }
+        if group.len() > 1 {
+            on_group(&group);
+        }
+        Ok(())
+    }
+
+    /// Rebuilds the persistent `match_index` table when the `files` table
+    /// has changed since the last build, and reports which group keys were
+    /// added or removed. Staleness is tracked by triggers bumping
+    /// `match_index_state.change_counter` on every `files` write, so the
+    /// check is O(1) and a fresh index returns `Ok(None)` without touching
+    /// the `files` table at all. Group keys use the same `algo:hex` form
+    /// the web UI has always shown, with sha256 as the fallback for rows
+    /// that have no blake3.
+    pub fn refresh_match_index(&self) -> Result<Option<MatchIndexDelta>> {
+        let (change_counter, indexed_counter): (i64, i64) = self.conn.query_row(
+            "SELECT change_counter, indexed_counter FROM match_index_state WHERE id = 1",
+            [],
+            |r| Ok((r.get(0)?, r.get(1)?)),
+        )?;
+        if change_counter == indexed_counter {
+            return Ok(None);
+        }
+
+        let before = self.load_match_index_members()?;
+
+        let id_col = self.file_id_column();
+        self.conn.execute_batch(&format!(
+            r#"
+            BEGIN;
+            DELETE FROM match_index;
+
+            INSERT INTO match_index (group_key, file_id)
+            SELECT 'blake3:' || lower(hex(f.blake3)), f.{id_col}
+            FROM files f
+            JOIN (
+              SELECT blake3 FROM files
+              WHERE blake3 IS NOT NULL
+              GROUP BY blake3 HAVING COUNT(*) > 1
+            ) dup ON f.blake3 = dup.blake3;
+
+            INSERT INTO match_index (group_key, file_id)
+            SELECT 'sha256:' || lower(hex(f.sha256)), f.{id_col}
+            FROM files f
+            JOIN (
+              SELECT sha256 FROM files
+              WHERE blake3 IS NULL AND sha256 IS NOT NULL
+              GROUP BY sha256 HAVING COUNT(*) > 1
+            ) dup ON f.sha256 = dup.sha256
+            WHERE f.blake3 IS NULL;
+
+            UPDATE match_index_state SET indexed_counter = change_counter WHERE id = 1;
+            COMMIT;
+            "#
+        ))?;
+
+        let after = self.load_match_index_members()?;
+        let mut delta = MatchIndexDelta {
+            total_groups: after.len() as u64,
+            ..MatchIndexDelta::default()
+        };
+        for (key, members) in &after {
+            if before.get(key) != Some(members) {
+                delta.added.push(key.clone());
+            }
+        }
+        for key in before.keys() {
+            if !after.contains_key(key) {
+                delta.removed.push(key.clone());
+            }
+        }
+        delta.added.sort();
+        delta.removed.sort();
+        Ok(Some(delta))
+    }
+
+    /// Snapshot of the match index as `group_key -> member file ids`,
+    /// members ordered by id so equality means "same group".
+    fn load_match_index_members(&self) -> Result<HashMap<String, Vec<i64>>> {
+        let mut stmt = self
+            .conn
+            .prepare("SELECT group_key, file_id FROM match_index ORDER BY group_key, file_id")?;
+        let rows = stmt.query_map([], |r| Ok((r.get::<_, String>(0)?, r.get::<_, i64>(1)?)))?;
+        let mut out: HashMap<String, Vec<i64>> = HashMap::new();
+        for row in rows {
+            let (key, file_id) = row?;
+            out.entry(key).or_default().push(file_id);
+        }
+        Ok(out)
+    }
+
+    /// Serves match groups straight from the persistent index — no
+    /// grouping SQL runs here, just a paged key lookup joined back to
+    /// `files`. `limit`/`offset` count groups (largest first), not rows.
+    /// Call [`SqliteScanStore::refresh_match_index`] first if the caller
+    /// needs the index to reflect the latest scan.
+    pub fn list_match_groups(
+        &self,
+        limit: usize,
+        offset: usize,
+    ) -> Result<Vec<(String, Vec<FileListRow>)>> {
+        let id_col = self.file_id_column();
+        let sql = format!(
+            r#"
+            SELECT sel.group_key, f.{id_col} AS id, f.path, f.size_bytes, f.modified_at_secs, f.blake3, f.sha256, f.ahash, f.dhash, f.phash, f.ffmpeg_metadata, f.file_type
+            FROM (
+              SELECT group_key, COUNT(*) AS member_count
+              FROM match_index
+              GROUP BY group_key
+              ORDER BY member_count DESC, group_key
+              LIMIT ?1 OFFSET ?2
+            ) sel
+            JOIN match_index mi ON mi.group_key = sel.group_key
+            JOIN files f ON f.{id_col} = mi.file_id
+            ORDER BY sel.member_count DESC, sel.group_key, f.path
+            "#
+        );
+        let mut stmt = self.conn.prepare(&sql)?;
+        let rows = stmt.query_map(params![limit as i64, offset as i64], |r| {
+            Ok((r.get::<_, String>(0)?, keyed_file_list_row(r)?))
+        })?;
+        collect_keyed_groups(rows)
+    }
+
+    /// Fetches the current membership of specific index groups, in key
+    /// order. Used to build SSE delta payloads: the server pushes the full
+    /// content of changed groups so clients can patch their view without
+    /// re-fetching the whole match list.
+    pub fn list_match_groups_for_keys(
+        &self,
+        keys: &[String],
+    ) -> Result<Vec<(String, Vec<FileListRow>)>> {
+        if keys.is_empty() {
+            return Ok(Vec::new());
+        }
+        let id_col = self.file_id_column();
+        let placeholders = vec!["?"; keys.len()].join(", ");
+        let sql = format!(
+            r#"
+            SELECT mi.group_key, f.{id_col} AS id, f.path, f.size_bytes, f.modified_at_secs, f.blake3, f.sha256, f.ahash, f.dhash, f.phash, f.ffmpeg_metadata, f.file_type
+            FROM match_index mi
+            JOIN files f ON f.{id_col} = mi.file_id
+            WHERE mi.group_key IN ({placeholders})
+            ORDER BY mi.group_key, f.path
+            "#
+        );
+        let mut stmt = self.conn.prepare(&sql)?;
+        let rows = stmt.query_map(params_from_iter(keys.iter()), |r| {
+            Ok((r.get::<_, String>(0)?, keyed_file_list_row(r)?))
+        })?;
+        collect_keyed_groups(rows)
+    }
+
+    /// Streams every row that has a blake3, ordered by blake3, so the
+    /// columnar hash-index export (see [`crate::export`]) writes its
+    /// sorted key column straight off `idx_files_blake3` without an
+    /// in-memory sort.
+    pub fn for_each_hashed_file<F>(&self, mut f: F) -> Result<()>
+    where
+        F: FnMut(&str, u64, &[u8; 32], Option<u64>),
+    {
+        let mut stmt = self.conn.prepare(
+            r#"
+            SELECT path, size_bytes, blake3, phash
+            FROM files
+            WHERE blake3 IS NOT NULL
+            ORDER BY blake3, path
+            "#,
+        )?;
+        let mut rows = stmt.query([])?;
+        while let Some(r) = rows.next()? {
+            let path: String = r.get(0)?;
+            let size: i64 = r.get(1)?;
+            let blake3: Vec<u8> = r.get(2)?;
+            let phash: Option<i64> = r.get(3)?;
+            let Ok(hash) = <[u8; 32]>::try_from(blake3.as_slice()) else {
+                continue;
+            };
+            f(&path, size.max(0) as u64, &hash, phash.map(|v| v as u64));
+        }
+        Ok(())
+    }
+
+    /// Compares this fileset against another scan database by content
+    /// hash. The other database is `ATTACH`ed so the whole comparison runs
+    /// inside SQLite over both `files` tables: a row matches when its
+    /// blake3 exists on the other side, and rows missing exactly are
+    /// additionally checked for an identical phash — the same picture or
+    /// video stored with different bytes. Labels come from each fileset's
+    /// metadata (name, falling back to root path).
+    pub fn compare_with_fileset(&self, other_db: &Path) -> Result<FilesetComparison> {
+        if !other_db.is_file() {
+            // ATTACH would silently create an empty database here.
+            return Err(Error::InvalidArgument(format!(
+                "fileset database does not exist: {}",
+                other_db.to_string_lossy()
+            )));
+        }
+        self.conn.execute(
+            "ATTACH DATABASE ?1 AS other",
+            params![other_db.to_string_lossy()],
+        )?;
+        let result = self.compare_attached();
+        let _ = self.conn.execute("DETACH DATABASE other", []);
+        result
+    }
+
+    fn compare_attached(&self) -> Result<FilesetComparison> {
+        let label = |table: &str| -> Result<String> {
+            let sql = format!(
+                "SELECT COALESCE(NULLIF(name, ''), root_path, '') FROM {table} WHERE id = 1"
+            );
+            Ok(self
+                .conn
+                .query_row(&sql, [], |r| r.get(0))
+                .optional()?
+                .unwrap_or_default())
+        };
+        let count = |sql: &str| -> Result<u64> {
+            Ok(self.conn.query_row(sql, [], |r| r.get::<_, i64>(0))? as u64)
+        };
+
+        Ok(FilesetComparison {
+            self_label: label("fileset")?,
+            other_label: label("other.fileset")?,
+            matched_files: count(
+                r#"
+                SELECT COUNT(*) FROM files m
+                WHERE m.blake3 IS NOT NULL
+                  AND EXISTS (SELECT 1 FROM other.files o WHERE o.blake3 = m.blake3)
+                "#,
+            )?,
+            self_unhashed: count("SELECT COUNT(*) FROM files WHERE blake3 IS NULL")?,
+            other_unhashed: count("SELECT COUNT(*) FROM other.files WHERE blake3 IS NULL")?,
+            only_in_self: self.diff_rows("files", "other.files")?,
+            only_in_other: self.diff_rows("other.files", "files")?,
+        })
+    }
+
+    /// Rows of `source` whose blake3 does not appear in `target`, with a
+    /// flag for rows whose phash does — both probes ride the hash indexes
+    /// on each side.
+    fn diff_rows(&self, source: &str, target: &str) -> Result<Vec<FilesetDiffRow>> {
+        let sql = format!(
+            r#"
+            SELECT s.path, s.size_bytes, s.file_type,
+                   (s.phash IS NOT NULL AND EXISTS (
+                      SELECT 1 FROM {target} t2 WHERE t2.phash = s.phash
+                   )) AS phash_match
+            FROM {source} s
+            WHERE s.blake3 IS NOT NULL
+              AND NOT EXISTS (SELECT 1 FROM {target} t WHERE t.blake3 = s.blake3)
+            ORDER BY s.path
+            "#
+        );
+        let mut stmt = self.conn.prepare(&sql)?;
+        let rows = stmt.query_map([], |r| {
+            Ok(FilesetDiffRow {
+                path: Path::new(r.get::<_, String>(0)?.as_str()).to_path_buf(),
+                size_bytes: r.get::<_, i64>(1)? as u64,
+                file_type: r.get(2)?,
+                phash_match: r.get::<_, i64>(3)? != 0,
+            })
+        })?;
+
+        let mut out = Vec::new();
+        for row in rows {
+            out.push(row?);
+        }
+        Ok(out)
+    }
+
+    /// Keyset-paginated variant of [`list_files`] /
+    /// [`list_files_with_duplicates`]: returns up to `limit` rows whose
+    /// paths sort strictly after `after_path`, in path order. Paths are
+    /// unique, so each page picks up exactly where the previous one ended,
+    /// and — unlike OFFSET — the cost of a page does not grow with how deep
+    /// into the fileset it sits.
+    pub fn list_files_page(
+        &self,
+        after_path: Option<&Path>,
+        limit: usize,
+        duplicates_only: bool,
+    ) -> Result<Vec<FileListRow>> {
+        let id_col = self.file_id_column();
+        let dup_filter = if duplicates_only {
+            format!(
+                r#"
+                AND ((
+                    f1.blake3 IS NOT NULL
+                    AND EXISTS (
+                      SELECT 1 FROM files f2
+                      WHERE f2.blake3 = f1.blake3 AND f2.{id_col} != f1.{id_col}
+                    )
+                  ) OR (
+                    f1.blake3 IS NULL
+                    AND f1.sha256 IS NOT NULL
+                    AND EXISTS (
+                      SELECT 1 FROM files f2
+                      WHERE f2.sha256 = f1.sha256 AND f2.{id_col} != f1.{id_col}
+                    )
+                  ))
+                "#
+            )
+        } else {
+            String::new()
+        };
+        let sql = format!(
+            r#"
+            SELECT f1.{id_col} AS id, f1.path, f1.size_bytes, f1.modified_at_secs, f1.blake3, f1.sha256, f1.ahash, f1.dhash, f1.phash, f1.ffmpeg_metadata, f1.file_type
+            FROM files f1
+            WHERE f1.path > ?1
+            {dup_filter}
+            ORDER BY f1.path
+            LIMIT ?2
+            "#
+        );
+        let after = after_path
+            .map(|p| p.to_string_lossy().into_owned())
+            .unwrap_or_default();
+        let mut stmt = self.conn.prepare_cached(&sql)?;
+        let rows = stmt.query_map(params![after, limit as i64], |r| {
+            let modified_at_secs: Option<i64> = r.get(3)?;
+            let blake3: Option<Vec<u8>> = r.get(4)?;
+            let sha256: Option<Vec<u8>> = r.get(5)?;
+            let ahash: Option<i64> = r.get(6)?;
+            let dhash: Option<i64> = r.get(7)?;
+            let phash: Option<i64> = r.get(8)?;
+            Ok(FileListRow {
+                id: r.get(0)?,
+                path: Path::new(r.get::<_, String>(1)?.as_str()).to_path_buf(),
+                size_bytes: r.get::<_, i64>(2)? as u64,
+                modified_at: modified_at_secs.map(|v| secs_to_system_time(v.max(0) as u64)),
+                blake3: blob_to_hash(blake3),
+                sha256: blob_to_hash(sha256),
+                ahash: ahash.map(|v| v as u64),
+                dhash: dhash.map(|v| v as u64),
+                phash: phash.map(|v| v as u64),
+                ffmpeg_metadata: r.get(9)?,
+                file_type: r.get(10)?,
+            })
+        })?;
+
+        let mut out = Vec::new();
+        for row in rows {
+            out.push(row?);
+        }
+        Ok(out)
+    }
+
     pub fn list_files_with_hashes(&self, limit: usize, offset: usize) -> Result<Vec<FileListRow>> {
         let id_col = self.file_id_column();
         let sql = format!(
@@ -567,7 +1164,7 @@ impl SqliteScanStore {
         let id_col = self.file_id_column();
         let sql = format!(
             r#"
-            SELECT path, size_bytes, modified_at_secs, blake3, sha256, ahash, dhash, phash, ffmpeg_metadata, file_type
+            SELECT path, size_bytes, modified_at_secs, blake3, sha256, ahash, dhash, phash, ffmpeg_metadata, file_type, sample_hash
             FROM files
             WHERE {id_col} = ?1
             "#
@@ -577,6 +1174,7 @@ impl SqliteScanStore {
             .query_row(&sql, params![file_id], |r| {
                 let blake3: Option<Vec<u8>> = r.get(3)?;
                 let sha256: Option<Vec<u8>> = r.get(4)?;
+                let sample_hash: Option<Vec<u8>> = r.get(10)?;
                 let ahash: Option<i64> = r.get(5)?;
                 let dhash: Option<i64> = r.get(6)?;
                 let phash: Option<i64> = r.get(7)?;
@@ -588,6 +1186,7 @@ impl SqliteScanStore {
                     modified_at: modified_at_secs.map(|v| secs_to_system_time(v.max(0) as u64)),
                     blake3: blob_to_hash(blake3),
                     sha256: blob_to_hash(sha256),
+                    sample_hash: blob_to_hash(sample_hash),
                     ahash: ahash.map(|v| v as u64),
                     dhash: dhash.map(|v| v as u64),
                     phash: phash.map(|v| v as u64),
@@ -603,7 +1202,7 @@ impl SqliteScanStore {
         let id_col = self.file_id_column();
         let sql = format!(
             r#"
-            SELECT {id_col} AS id, size_bytes, modified_at_secs, blake3, sha256, ahash, dhash, phash, ffmpeg_metadata, file_type
+            SELECT {id_col} AS id, size_bytes, modified_at_secs, blake3, sha256, ahash, dhash, phash, ffmpeg_metadata, file_type, sample_hash
             FROM files
             WHERE path = ?1
             "#
@@ -613,6 +1212,7 @@ impl SqliteScanStore {
             .query_row(&sql, params![path.to_string_lossy()], |r| {
                 let blake3: Option<Vec<u8>> = r.get(3)?;
                 let sha256: Option<Vec<u8>> = r.get(4)?;
+                let sample_hash: Option<Vec<u8>> = r.get(10)?;
                 let ahash: Option<i64> = r.get(5)?;
                 let dhash: Option<i64> = r.get(6)?;
                 let phash: Option<i64> = r.get(7)?;
@@ -624,6 +1224,7 @@ impl SqliteScanStore {
                     modified_at: modified_at_secs.map(|v| secs_to_system_time(v.max(0) as u64)),
                     blake3: blob_to_hash(blake3),
                     sha256: blob_to_hash(sha256),
+                    sample_hash: blob_to_hash(sample_hash),
                     ahash: ahash.map(|v| v as u64),
                     dhash: dhash.map(|v| v as u64),
                     phash: phash.map(|v| v as u64),
@@ -664,6 +1265,153 @@ impl SqliteScanStore {
         Ok(out)
     }
 
+    /// Rowid and byte length of one snapshot's AVIF blob, for use with
+    /// [`SqliteScanStore::read_snapshot_blob_at`]. Only the length is
+    /// computed — the blob itself stays on disk. Returns `None` when the
+    /// snapshot does not exist.
+    pub fn locate_snapshot_blob(
+        &self,
+        file_id: i64,
+        snapshot_index: u32,
+    ) -> Result<Option<(i64, u64)>> {
+        let mut stmt = self.conn.prepare_cached(
+            r#"
+            SELECT rowid, length(image_avif)
+            FROM file_snapshots
+            WHERE file_id = ?1 AND snapshot_index = ?2
+            "#,
+        )?;
+        let row = stmt
+            .query_row(params![file_id, snapshot_index as i64], |r| {
+                Ok((r.get::<_, i64>(0)?, r.get::<_, i64>(1)? as u64))
+            })
+            .optional()?;
+        Ok(row)
+    }
+
+    /// Reads up to `buf.len()` bytes of a snapshot's AVIF blob starting at
+    /// `offset`, via SQLite's incremental blob I/O. The blob is never
+    /// materialized in full: bytes go straight from the database pages into
+    /// the caller's buffer, so a host can stream a multi-megabyte blob in
+    /// chunks. Returns the number of bytes read — short only at the end of
+    /// the blob, zero at or past it.
+    pub fn read_snapshot_blob_at(&self, rowid: i64, offset: u64, buf: &mut [u8]) -> Result<usize> {
+        let blob = self.conn.blob_open(
+            DatabaseName::Main,
+            "file_snapshots",
+            "image_avif",
+            rowid,
+            true,
+        )?;
+        let len = blob.len();
+        let offset = (offset.min(len as u64)) as usize;
+        let take = buf.len().min(len - offset);
+        if take == 0 {
+            return Ok(0);
+        }
+        blob.read_at_exact(&mut buf[..take], offset)?;
+        Ok(take)
+    }
+
+    /// Per-file phash sequences over all stored snapshots, ordered by
+    /// snapshot index. Only the 8-byte hashes are pulled — the AVIF blobs
+    /// stay on disk — so this is cheap even for large filesets. Files
+    /// without any phashed snapshots are not returned.
+    pub fn list_snapshot_phash_sequences(&self) -> Result<Vec<(i64, Vec<u64>)>> {
+        let mut stmt = self.conn.prepare(
+            r#"
+            SELECT file_id, phash
+            FROM file_snapshots
+            WHERE phash IS NOT NULL
+            ORDER BY file_id, snapshot_index
+            "#,
+        )?;
+        let rows = stmt.query_map([], |r| {
+            Ok((r.get::<_, i64>(0)?, r.get::<_, i64>(1)? as u64))
+        })?;
+
+        let mut out: Vec<(i64, Vec<u64>)> = Vec::new();
+        for row in rows {
+            let (file_id, phash) = row?;
+            match out.last_mut() {
+                Some((id, hashes)) if *id == file_id => hashes.push(phash),
+                _ => out.push((file_id, vec![phash])),
+            }
+        }
+        Ok(out)
+    }
+
+    /// Rows written by a lazy-hashing scan that still need full content
+    /// hashes: their (size, sample_hash) pair collides with at least one
+    /// other row, so they could be exact duplicates. Size-unique files are
+    /// never returned — they cannot have an exact match in this fileset.
+    pub fn list_deferred_hash_candidates(&self) -> Result<Vec<(i64, PathBuf)>> {
+        let id_col = self.file_id_column();
+        let sql = format!(
+            r#"
+            SELECT f.{id_col} AS id, f.path
+            FROM files f
+            JOIN (
+              SELECT size_bytes, COALESCE(sample_hash, X'') AS sample
+              FROM files
+              GROUP BY size_bytes, COALESCE(sample_hash, X'')
+              HAVING COUNT(*) > 1
+            ) d
+              ON f.size_bytes = d.size_bytes
+             AND COALESCE(f.sample_hash, X'') = d.sample
+            WHERE f.blake3 IS NULL AND f.sha256 IS NULL
+            ORDER BY f.size_bytes, f.path
+            "#
+        );
+        let mut stmt = self.conn.prepare(&sql)?;
+        let rows = stmt.query_map([], |r| {
+            Ok((
+                r.get::<_, i64>(0)?,
+                Path::new(r.get::<_, String>(1)?.as_str()).to_path_buf(),
+            ))
+        })?;
+
+        let mut out = Vec::new();
+        for row in rows {
+            out.push(row?);
+        }
+        Ok(out)
+    }
+
+    /// Path, size and mtime of every row; used by incremental rescans to
+    /// decide which files can skip reprocessing.
+    pub fn list_file_identities(&self) -> Result<Vec<(PathBuf, u64, Option<i64>)>> {
+        let mut stmt = self
+            .conn
+            .prepare("SELECT path, size_bytes, modified_at_secs FROM files")?;
+        let rows = stmt.query_map([], |r| {
+            Ok((
+                Path::new(r.get::<_, String>(0)?.as_str()).to_path_buf(),
+                r.get::<_, i64>(1)? as u64,
+                r.get::<_, Option<i64>>(2)?,
+            ))
+        })?;
+
+        let mut out = Vec::new();
+        for row in rows {
+            out.push(row?);
+        }
+        Ok(out)
+    }
+
+    pub fn update_file_content_hashes(
+        &self,
+        file_id: i64,
+        blake3: &[u8; 32],
+        sha256: &[u8; 32],
+    ) -> Result<()> {
+        let id_col = self.file_id_column();
+        let sql = format!("UPDATE files SET blake3 = ?1, sha256 = ?2 WHERE {id_col} = ?3");
+        let mut stmt = self.conn.prepare_cached(&sql)?;
+        stmt.execute(params![blake3.to_vec(), sha256.to_vec(), file_id])?;
+        Ok(())
+    }
+
     pub fn delete_file_by_path(&self, path: &Path) -> Result<bool> {
         let affected = self.conn.execute(
             "DELETE FROM files WHERE path = ?1",
@@ -673,6 +1421,98 @@ impl SqliteScanStore {
     }
 }
 
+/// Upsert statement for `rows` files at once. Callers should stick to a
+/// small set of row counts so `prepare_cached` actually hits.
+fn files_upsert_sql(rows: usize) -> String {
+    let row_placeholders = "(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+    let values = vec![row_placeholders; rows.max(1)].join(", ");
+    format!(
+        r#"
+        INSERT INTO files (
+          path, size_bytes, modified_at_secs, blake3, sha256, sample_hash, ahash, dhash, phash, ffmpeg_metadata, file_type
+        ) VALUES {values}
+        ON CONFLICT(path) DO UPDATE SET
+          size_bytes=excluded.size_bytes,
+          modified_at_secs=excluded.modified_at_secs,
+          blake3=excluded.blake3,
+          sha256=excluded.sha256,
+          sample_hash=excluded.sample_hash,
+          ahash=excluded.ahash,
+          dhash=excluded.dhash,
+          phash=excluded.phash,
+          ffmpeg_metadata=excluded.ffmpeg_metadata,
+          file_type=excluded.file_type
+        "#
+    )
+}
+
+fn file_row_values(rec: &MediaFileRecord) -> [Value; 11] {
+    fn opt_i64(v: Option<i64>) -> Value {
+        v.map(Value::Integer).unwrap_or(Value::Null)
+    }
+    fn opt_blob(v: Option<[u8; 32]>) -> Value {
+        v.map(|b| Value::Blob(b.to_vec())).unwrap_or(Value::Null)
+    }
+    fn opt_text(v: Option<&str>) -> Value {
+        v.map(|s| Value::Text(s.to_string())).unwrap_or(Value::Null)
+    }
+
+    let modified_at_secs = rec.modified_at.map(system_time_to_secs).map(|v| v as i64);
+    [
+        Value::Text(rec.path.to_string_lossy().to_string()),
+        Value::Integer(rec.size_bytes as i64),
+        opt_i64(modified_at_secs),
+        opt_blob(rec.blake3),
+        opt_blob(rec.sha256),
+        opt_blob(rec.sample_hash),
+        opt_i64(rec.ahash.map(|v| v as i64)),
+        opt_i64(rec.dhash.map(|v| v as i64)),
+        opt_i64(rec.phash.map(|v| v as i64)),
+        opt_text(rec.ffmpeg_metadata.as_deref()),
+        opt_text(rec.file_type.as_deref()),
+    ]
+}
+
+/// Maps a match-index join row where column 0 is the group key and the
+/// `files` columns start at index 1.
+fn keyed_file_list_row(r: &rusqlite::Row<'_>) -> rusqlite::Result<FileListRow> {
+    let modified_at_secs: Option<i64> = r.get(4)?;
+    let blake3: Option<Vec<u8>> = r.get(5)?;
+    let sha256: Option<Vec<u8>> = r.get(6)?;
+    let ahash: Option<i64> = r.get(7)?;
+    let dhash: Option<i64> = r.get(8)?;
+    let phash: Option<i64> = r.get(9)?;
+    Ok(FileListRow {
+        id: r.get(1)?,
+        path: Path::new(r.get::<_, String>(2)?.as_str()).to_path_buf(),
+        size_bytes: r.get::<_, i64>(3)? as u64,
+        modified_at: modified_at_secs.map(|v| secs_to_system_time(v.max(0) as u64)),
+        blake3: blob_to_hash(blake3),
+        sha256: blob_to_hash(sha256),
+        ahash: ahash.map(|v| v as u64),
+        dhash: dhash.map(|v| v as u64),
+        phash: phash.map(|v| v as u64),
+        ffmpeg_metadata: r.get(10)?,
+        file_type: r.get(11)?,
+    })
+}
+
+/// Folds `(group_key, row)` pairs (already ordered so equal keys are
+/// adjacent) into per-group row vectors, preserving query order.
+fn collect_keyed_groups(
+    rows: impl Iterator<Item = rusqlite::Result<(String, FileListRow)>>,
+) -> Result<Vec<(String, Vec<FileListRow>)>> {
+    let mut out: Vec<(String, Vec<FileListRow>)> = Vec::new();
+    for row in rows {
+        let (key, file) = row?;
+        match out.last_mut() {
+            Some((last_key, files)) if *last_key == key => files.push(file),
+            _ => out.push((key, vec![file])),
+        }
+    }
+    Ok(out)
+}
+
 fn blob_to_hash(blob: Option<Vec<u8>>) -> Option<[u8; 32]> {
     let bytes = blob?;
     if bytes.len() != 32 {
@@ -0,0 +1,348 @@
+//! Compact, versioned, mmap-able columnar export of a fileset's hash
+//! index.
+//!
+//! Scan databases run to tens of gigabytes once AVIF snapshots are
+//! embedded, but the hashes themselves are a few hundred megabytes. The
+//! `.ddnx` format exports just those: a sorted blake3 key column, a
+//! parallel phash column with a presence bitmap, sizes, and a path table,
+//! all little-endian and 8-byte aligned. A comparison tool maps the file
+//! read-only and binary-searches the key column directly in the mapped
+//! pages — nothing is parsed or copied at open time — which makes it the
+//! wire format for comparing filesets across machines.
+
+use std::fs::File;
+use std::io::{BufWriter, Write};
+use std::path::Path;
+
+use memmap2::Mmap;
+
+use crate::db::SqliteScanStore;
+use crate::error::{Error, Result};
+use crate::models::{FilesetComparison, FilesetDiffRow};
+
+pub const HASH_INDEX_MAGIC: [u8; 4] = *b"DDNX";
+pub const HASH_INDEX_VERSION: u32 = 1;
+
+/// Fixed-size header: magic, version, row count, then byte offsets of
+/// each section. Offsets are absolute and 8-byte aligned; unused header
+/// bytes are zero.
+const HEADER_LEN: u64 = 96;
+
+#[derive(Debug, Clone, Copy)]
+pub struct HashIndexExportStats {
+    pub rows: u64,
+    pub bytes: u64,
+}
+
+/// Writes the fileset's hash index to `out_path` in `.ddnx` form. Only
+/// rows with a blake3 are exported — rows that were never content-hashed
+/// cannot be compared anyway. Columns are buffered in memory (tens of
+/// bytes per row) and written in one pass.
+pub fn export_hash_index(store: &SqliteScanStore, out_path: &Path) -> Result<HashIndexExportStats> {
+    let label = store
+        .get_fileset_metadata()?
+        .map(|meta| {
+            if meta.name.is_empty() {
+                meta.root_path.to_string_lossy().into_owned()
+            } else {
+                meta.name
+            }
+        })
+        .unwrap_or_default();
+
+    let mut rows = 0u64;
+    let mut blake3_col: Vec<u8> = Vec::new();
+    let mut phash_col: Vec<u8> = Vec::new();
+    let mut phash_bitmap: Vec<u8> = Vec::new();
+    let mut size_col: Vec<u8> = Vec::new();
+    let mut path_offsets: Vec<u8> = Vec::new();
+    let mut path_blob: Vec<u8> = Vec::new();
+    store.for_each_hashed_file(|path, size, blake3, phash| {
+        let idx = rows as usize;
+        rows += 1;
+        blake3_col.extend_from_slice(blake3);
+        phash_col.extend_from_slice(&phash.unwrap_or_default().to_le_bytes());
+        if idx % 8 == 0 {
+            phash_bitmap.push(0);
+        }
+        if phash.is_some() {
+            *phash_bitmap.last_mut().expect("bitmap byte pushed above") |= 1 << (idx % 8);
+        }
+        size_col.extend_from_slice(&size.to_le_bytes());
+        path_offsets.extend_from_slice(&(path_blob.len() as u64).to_le_bytes());
+        path_blob.extend_from_slice(path.as_bytes());
+    })?;
+    // One sentinel offset past the end so row paths are offset-pair slices.
+    path_offsets.extend_from_slice(&(path_blob.len() as u64).to_le_bytes());
+
+    let align = |off: u64| (off + 7) & !7;
+    let blake3_off = HEADER_LEN;
+    let phash_off = align(blake3_off + blake3_col.len() as u64);
+    let phash_bitmap_off = align(phash_off + phash_col.len() as u64);
+    let size_off = align(phash_bitmap_off + phash_bitmap.len() as u64);
+    let path_offsets_off = align(size_off + size_col.len() as u64);
+    let path_blob_off = align(path_offsets_off + path_offsets.len() as u64);
+    let label_off = align(path_blob_off + path_blob.len() as u64);
+    let total = label_off + label.len() as u64;
+
+    let mut out = BufWriter::new(File::create(out_path)?);
+    let mut written = 0u64;
+    let mut write_at = |out: &mut BufWriter<File>, off: u64, bytes: &[u8]| -> Result<()> {
+        debug_assert!(off >= written);
+        for _ in written..off {
+            out.write_all(&[0])?;
+        }
+        out.write_all(bytes)?;
+        written = off + bytes.len() as u64;
+        Ok(())
+    };
+
+    let mut header = Vec::with_capacity(HEADER_LEN as usize);
+    header.extend_from_slice(&HASH_INDEX_MAGIC);
+    header.extend_from_slice(&HASH_INDEX_VERSION.to_le_bytes());
+    header.extend_from_slice(&rows.to_le_bytes());
+    header.extend_from_slice(&blake3_off.to_le_bytes());
+    header.extend_from_slice(&phash_off.to_le_bytes());
+    header.extend_from_slice(&phash_bitmap_off.to_le_bytes());
+    header.extend_from_slice(&size_off.to_le_bytes());
+    header.extend_from_slice(&path_offsets_off.to_le_bytes());
+    header.extend_from_slice(&path_blob_off.to_le_bytes());
+    header.extend_from_slice(&(path_blob.len() as u64).to_le_bytes());
+    header.extend_from_slice(&label_off.to_le_bytes());
+    header.extend_from_slice(&(label.len() as u64).to_le_bytes());
+    header.resize(HEADER_LEN as usize, 0);
+
+    write_at(&mut out, 0, &header)?;
+    write_at(&mut out, blake3_off, &blake3_col)?;
+    write_at(&mut out, phash_off, &phash_col)?;
+    write_at(&mut out, phash_bitmap_off, &phash_bitmap)?;
+    write_at(&mut out, size_off, &size_col)?;
+    write_at(&mut out, path_offsets_off, &path_offsets)?;
+    write_at(&mut out, path_blob_off, &path_blob)?;
+    write_at(&mut out, label_off, label.as_bytes())?;
+    out.flush()?;
+
+    Ok(HashIndexExportStats { rows, bytes: total })
+}
+
+/// Read-only view over an exported hash index, backed by a shared mmap.
+/// Lookups binary-search the sorted blake3 column directly in the mapped
+/// pages; opening validates the header, the section bounds, and the path
+/// offsets column, so the per-row accessors never slice out of bounds.
+pub struct HashIndexFile {
+    map: Mmap,
+    rows: usize,
+    blake3_off: usize,
+    phash_off: usize,
+    phash_bitmap_off: usize,
+    size_off: usize,
+    path_offsets_off: usize,
+    path_blob_off: usize,
+    path_blob_len: usize,
+    label_off: usize,
+    label_len: usize,
+}
+
+impl HashIndexFile {
+    pub fn open(path: &Path) -> Result<Self> {
+        let file = File::open(path)?;
+        let map = unsafe { Mmap::map(&file)? };
+        if map.len() < HEADER_LEN as usize {
+            return Err(Error::InvalidArgument(format!(
+                "not a hash index (too short): {}",
+                path.to_string_lossy()
+            )));
+        }
+        if map[0..4] != HASH_INDEX_MAGIC {
+            return Err(Error::InvalidArgument(format!(
+                "not a hash index (bad magic): {}",
+                path.to_string_lossy()
+            )));
+        }
+        let u32_at = |off: usize| u32::from_le_bytes(map[off..off + 4].try_into().unwrap());
+        let u64_at =
+            |off: usize| u64::from_le_bytes(map[off..off + 8].try_into().unwrap()) as usize;
+        let version = u32_at(4);
+        if version != HASH_INDEX_VERSION {
+            return Err(Error::InvalidArgument(format!(
+                "unsupported hash index version {version} (expected {HASH_INDEX_VERSION})"
+            )));
+        }
+
+        let rows = u64_at(8);
+        let index = Self {
+            rows,
+            blake3_off: u64_at(16),
+            phash_off: u64_at(24),
+            phash_bitmap_off: u64_at(32),
+            size_off: u64_at(40),
+            path_offsets_off: u64_at(48),
+            path_blob_off: u64_at(56),
+            path_blob_len: u64_at(64),
+            label_off: u64_at(72),
+            label_len: u64_at(80),
+            map,
+        };
+
+        let end = index.map.len();
+        let sections = [
+            (index.blake3_off, rows.checked_mul(32)),
+            (index.phash_off, rows.checked_mul(8)),
+            (index.phash_bitmap_off, Some(rows.div_ceil(8))),
+            (index.size_off, rows.checked_mul(8)),
+            (index.path_offsets_off, (rows + 1).checked_mul(8)),
+            (index.path_blob_off, Some(index.path_blob_len)),
+            (index.label_off, Some(index.label_len)),
+        ];
+        for (off, len) in sections {
+            let in_bounds = len
+                .and_then(|len| off.checked_add(len))
+                .is_some_and(|section_end| section_end <= end);
+            if !in_bounds {
+                return Err(Error::InvalidArgument(format!(
+                    "corrupt hash index (section out of bounds): {}",
+                    path.to_string_lossy()
+                )));
+            }
+        }
+
+        // The per-row offsets are used as unchecked slice bounds by
+        // `path_at`, so validate the whole column here: non-decreasing,
+        // never past the path blob, ending exactly at its length. One
+        // linear pass over 8-byte values keeps every later row access
+        // panic-free on a bit-flipped file whose header still checks out.
+        let mut prev = 0usize;
+        for idx in 0..=rows {
+            let off = index.path_offsets_off + idx * 8;
+            let value = u64::from_le_bytes(index.map[off..off + 8].try_into().unwrap()) as usize;
+            if value < prev || value > index.path_blob_len {
+                return Err(Error::InvalidArgument(format!(
+                    "corrupt hash index (path offsets out of bounds): {}",
+                    path.to_string_lossy()
+                )));
+            }
+            prev = value;
+        }
+        if prev != index.path_blob_len {
+            return Err(Error::InvalidArgument(format!(
+                "corrupt hash index (path offsets truncated): {}",
+                path.to_string_lossy()
+            )));
+        }
+        Ok(index)
+    }
+
+    pub fn row_count(&self) -> usize {
+        self.rows
+    }
+
+    pub fn label(&self) -> &str {
+        std::str::from_utf8(&self.map[self.label_off..self.label_off + self.label_len])
+            .unwrap_or("")
+    }
+
+    pub fn blake3_at(&self, idx: usize) -> &[u8; 32] {
+        let off = self.blake3_off + idx * 32;
+        self.map[off..off + 32].try_into().expect("32-byte column")
+    }
+
+    pub fn phash_at(&self, idx: usize) -> Option<u64> {
+        let present = self.map[self.phash_bitmap_off + idx / 8] & (1 << (idx % 8)) != 0;
+        if !present {
+            return None;
+        }
+        let off = self.phash_off + idx * 8;
+        Some(u64::from_le_bytes(
+            self.map[off..off + 8].try_into().expect("8-byte column"),
+        ))
+    }
+
+    pub fn size_at(&self, idx: usize) -> u64 {
+        let off = self.size_off + idx * 8;
+        u64::from_le_bytes(self.map[off..off + 8].try_into().expect("8-byte column"))
+    }
+
+    pub fn path_at(&self, idx: usize) -> &str {
+        let off = self.path_offsets_off + idx * 8;
+        let start = u64::from_le_bytes(self.map[off..off + 8].try_into().unwrap()) as usize;
+        let end = u64::from_le_bytes(self.map[off + 8..off + 16].try_into().unwrap()) as usize;
+        std::str::from_utf8(&self.map[self.path_blob_off + start..self.path_blob_off + end])
+            .unwrap_or("")
+    }
+
+    pub fn contains_blake3(&self, hash: &[u8; 32]) -> bool {
+        let (mut lo, mut hi) = (0, self.rows);
+        while lo < hi {
+            let mid = lo + (hi - lo) / 2;
+            match self.blake3_at(mid).cmp(hash) {
+                std::cmp::Ordering::Less => lo = mid + 1,
+                std::cmp::Ordering::Greater => hi = mid,
+                std::cmp::Ordering::Equal => return true,
+            }
+        }
+        false
+    }
+}
+
+/// Diffs two exported hash indexes with a single merge walk over their
+/// sorted blake3 columns, mirroring the shape of
+/// [`SqliteScanStore::compare_with_fileset`]. The unhashed counts are
+/// always zero — unhashed rows are not exported.
+pub fn compare_hash_indexes(a: &HashIndexFile, b: &HashIndexFile) -> FilesetComparison {
+    let phashes = |index: &HashIndexFile| -> std::collections::HashSet<u64> {
+        (0..index.row_count())
+            .filter_map(|idx| index.phash_at(idx))
+            .collect()
+    };
+    let a_phashes = phashes(a);
+    let b_phashes = phashes(b);
+
+    let diff_row = |index: &HashIndexFile,
+                    other_phashes: &std::collections::HashSet<u64>,
+                    idx: usize| FilesetDiffRow {
+        path: Path::new(index.path_at(idx)).to_path_buf(),
+        size_bytes: index.size_at(idx),
+        file_type: None,
+        phash_match: index
+            .phash_at(idx)
+            .is_some_and(|hash| other_phashes.contains(&hash)),
+    };
+
+    let mut comparison = FilesetComparison {
+        self_label: a.label().to_string(),
+        other_label: b.label().to_string(),
+        ..FilesetComparison::default()
+    };
+    let (mut i, mut j) = (0, 0);
+    while i < a.row_count() && j < b.row_count() {
+        match a.blake3_at(i).cmp(b.blake3_at(j)) {
+            std::cmp::Ordering::Less => {
+                comparison.only_in_self.push(diff_row(a, &b_phashes, i));
+                i += 1;
+            }
+            std::cmp::Ordering::Greater => {
+                comparison.only_in_other.push(diff_row(b, &a_phashes, j));
+                j += 1;
+            }
+            std::cmp::Ordering::Equal => {
+                let key = *a.blake3_at(i);
+                while i < a.row_count() && a.blake3_at(i) == &key {
+                    comparison.matched_files += 1;
+                    i += 1;
+                }
+                while j < b.row_count() && b.blake3_at(j) == &key {
+                    j += 1;
+                }
+            }
+        }
+    }
+    while i < a.row_count() {
+        comparison.only_in_self.push(diff_row(a, &b_phashes, i));
+        i += 1;
+    }
+    while j < b.row_count() {
+        comparison.only_in_other.push(diff_row(b, &a_phashes, j));
+        j += 1;
+    }
+    comparison
+}
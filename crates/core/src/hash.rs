@@ -1,10 +1,237 @@
 use std::fs::File;
-use std::io::{BufReader, Read};
+use std::io::{BufReader, Read, Seek, SeekFrom};
 use std::path::Path;
 
 use crate::error::Result;
 use sha2::{Digest, Sha256};
 
+/// How the hashing stage reads file contents off disk.
+///
+/// `Buffered` is the classic 128 KiB read loop and works everywhere.
+/// `Mmap` maps the file and advises the kernel of sequential access, which
+/// lets fast NVMe storage stream without a syscall per buffer. `Auto` picks
+/// mmap for files large enough to amortize the mapping cost.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum HashIoBackend {
+    #[default]
+    Auto,
+    Buffered,
+    Mmap,
+}
+
+/// Files below this size are always hashed through the buffered path; the
+/// mmap setup cost dominates for small files.
+const MMAP_MIN_FILE_BYTES: u64 = 4 * 1024 * 1024;
+
+/// All content digests for one file, produced from a single streaming read.
+#[derive(Debug, Clone, Copy)]
+pub struct FileHashes {
+    pub blake3: [u8; 32],
+    pub sha256: [u8; 32],
+}
+
+/// Computes every content digest in one pass over the file, feeding each
+/// buffer to all hashers so the bytes are read from disk exactly once.
+pub fn multi_hash_file(path: &Path) -> Result<FileHashes> {
+    multi_hash_file_with_backend(path, HashIoBackend::Auto)
+}
+
+/// Like [`multi_hash_file`], with an explicit I/O backend selection.
+pub fn multi_hash_file_with_backend(path: &Path, backend: HashIoBackend) -> Result<FileHashes> {
+    multi_hash_file_with_options(path, backend, false)
+}
+
+/// Like [`multi_hash_file_with_backend`], optionally dropping hashed bytes
+/// out of the page cache behind the read cursor.
+///
+/// A full scan otherwise streams every byte of the archive through the page
+/// cache exactly once, evicting the working set of whatever else shares the
+/// box. With `drop_behind` the file is advised sequential on open and each
+/// hashed region is released as soon as the cursor moves past it, so the
+/// scan's cache footprint stays a few megabytes regardless of archive size.
+pub fn multi_hash_file_with_options(
+    path: &Path,
+    backend: HashIoBackend,
+    drop_behind: bool,
+) -> Result<FileHashes> {
+    let file = File::open(path)?;
+    if drop_behind {
+        cache_hint::advise_sequential(&file);
+    }
+    let use_mmap = match backend {
+        HashIoBackend::Buffered => false,
+        HashIoBackend::Mmap => true,
+        HashIoBackend::Auto => file.metadata()?.len() >= MMAP_MIN_FILE_BYTES,
+    };
+
+    if use_mmap {
+        if let Some(hashes) = multi_hash_mapped(&file, drop_behind)? {
+            return Ok(hashes);
+        }
+        // Mapping can fail for special files (empty, FIFO-like, FS quirks);
+        // fall through to the buffered loop rather than failing the file.
+    }
+    multi_hash_buffered(file, drop_behind)
+}
+
+/// Granularity of drop-behind releases. Coarse enough that the advise
+/// syscall is amortized over many read buffers, small enough that the
+/// resident tail stays negligible.
+const DROP_BEHIND_SPAN_BYTES: u64 = 8 * 1024 * 1024;
+
+fn multi_hash_buffered(file: File, drop_behind: bool) -> Result<FileHashes> {
+    let mut reader = BufReader::new(file);
+    let mut blake3 = blake3::Hasher::new();
+    let mut sha256 = Sha256::new();
+
+    let mut hashed = 0u64;
+    let mut dropped = 0u64;
+    let mut buf = [0u8; 1024 * 128];
+    loop {
+        let read = reader.read(&mut buf)?;
+        if read == 0 {
+            break;
+        }
+        blake3.update(&buf[..read]);
+        sha256.update(&buf[..read]);
+
+        hashed += read as u64;
+        if drop_behind && hashed - dropped >= DROP_BEHIND_SPAN_BYTES {
+            cache_hint::release_range(reader.get_ref(), dropped, hashed - dropped);
+            dropped = hashed;
+        }
+    }
+    if drop_behind && hashed > dropped {
+        cache_hint::release_range(reader.get_ref(), dropped, hashed - dropped);
+    }
+
+    Ok(finalize_hashes(blake3, sha256))
+}
+
+fn multi_hash_mapped(file: &File, drop_behind: bool) -> Result<Option<FileHashes>> {
+    if file.metadata()?.len() == 0 {
+        return Ok(None);
+    }
+
+    // Safety: the mapping is read-only and dropped before returning; a
+    // concurrent truncation of the underlying file could fault, which is the
+    // same torn-read hazard the buffered path has for files modified mid-scan.
+    let map = match unsafe { memmap2::Mmap::map(file) } {
+        Ok(map) => map,
+        Err(_) => return Ok(None),
+    };
+    #[cfg(unix)]
+    let _ = map.advise(memmap2::Advice::Sequential);
+
+    let mut blake3 = blake3::Hasher::new();
+    let mut sha256 = Sha256::new();
+    // Chunked updates keep resident-set growth bounded and let the kernel
+    // read ahead while the previous chunk is being hashed.
+    let mut offset = 0u64;
+    for chunk in map.chunks(4 * 1024 * 1024) {
+        blake3.update(chunk);
+        sha256.update(chunk);
+        offset += chunk.len() as u64;
+    }
+
+    if drop_behind {
+        // Mapped pages pin their page-cache entries, so release the whole
+        // file once the mapping is gone rather than range by range.
+        drop(map);
+        cache_hint::release_range(file, 0, offset);
+    }
+
+    Ok(Some(finalize_hashes(blake3, sha256)))
+}
+
+/// Platform page-cache hints for the hashing read path. Every function is a
+/// best-effort no-op on failure — cache guidance must never fail a hash.
+#[cfg(target_os = "linux")]
+mod cache_hint {
+    use std::fs::File;
+    use std::os::unix::io::AsRawFd;
+
+    pub fn advise_sequential(file: &File) {
+        unsafe {
+            libc::posix_fadvise(file.as_raw_fd(), 0, 0, libc::POSIX_FADV_SEQUENTIAL);
+        }
+    }
+
+    pub fn release_range(file: &File, offset: u64, len: u64) {
+        unsafe {
+            libc::posix_fadvise(
+                file.as_raw_fd(),
+                offset as libc::off_t,
+                len as libc::off_t,
+                libc::POSIX_FADV_DONTNEED,
+            );
+        }
+    }
+}
+
+/// macOS has no posix_fadvise; F_RDAHEAD covers the sequential hint and
+/// F_NOCACHE keeps further reads from populating the unified buffer cache,
+/// which approximates drop-behind for a single sequential pass.
+#[cfg(target_os = "macos")]
+mod cache_hint {
+    use std::fs::File;
+    use std::os::unix::io::AsRawFd;
+
+    pub fn advise_sequential(file: &File) {
+        unsafe {
+            libc::fcntl(file.as_raw_fd(), libc::F_RDAHEAD, 1);
+            libc::fcntl(file.as_raw_fd(), libc::F_NOCACHE, 1);
+        }
+    }
+
+    pub fn release_range(_file: &File, _offset: u64, _len: u64) {}
+}
+
+#[cfg(not(any(target_os = "linux", target_os = "macos")))]
+mod cache_hint {
+    use std::fs::File;
+
+    pub fn advise_sequential(_file: &File) {}
+
+    pub fn release_range(_file: &File, _offset: u64, _len: u64) {}
+}
+
+fn finalize_hashes(blake3: blake3::Hasher, sha256: Sha256) -> FileHashes {
+    let sha256_digest = sha256.finalize();
+    let mut sha256_out = [0u8; 32];
+    sha256_out.copy_from_slice(&sha256_digest);
+    FileHashes {
+        blake3: *blake3.finalize().as_bytes(),
+        sha256: sha256_out,
+    }
+}
+
+/// Bytes sampled from each end of a file for [`sample_hash_file`].
+const SAMPLE_SPAN_BYTES: u64 = 64 * 1024;
+
+/// Cheap content fingerprint: blake3 over the file length plus the first and
+/// last 64 KiB. Two files with different sample hashes cannot be identical,
+/// so size-colliding groups can be pruned without reading whole files.
+pub fn sample_hash_file(path: &Path) -> Result<[u8; 32]> {
+    let mut file = File::open(path)?;
+    let len = file.metadata()?.len();
+
+    let mut hasher = blake3::Hasher::new();
+    hasher.update(&len.to_le_bytes());
+
+    let mut buf = vec![0u8; SAMPLE_SPAN_BYTES.min(len) as usize];
+    file.read_exact(&mut buf)?;
+    hasher.update(&buf);
+
+    if len > SAMPLE_SPAN_BYTES * 2 {
+        file.seek(SeekFrom::End(-(SAMPLE_SPAN_BYTES as i64)))?;
+        file.read_exact(&mut buf)?;
+        hasher.update(&buf);
+    }
+
+    Ok(*hasher.finalize().as_bytes())
+}
+
 pub fn blake3_file(path: &Path) -> Result<[u8; 32]> {
     let file = File::open(path)?;
     let mut reader = BufReader::new(file);
@@ -1,9 +1,12 @@
 pub mod db;
 pub mod drive;
 pub mod error;
+pub mod export;
 pub mod hash;
 pub mod models;
 pub mod scan;
+pub mod similar;
+pub mod thumbs;
 pub mod video;
 
 pub use crate::error::{Error, Result};
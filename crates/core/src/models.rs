@@ -22,6 +22,7 @@ pub struct MediaFileRecord {
     pub modified_at: Option<SystemTime>,
     pub blake3: Option<[u8; 32]>,
     pub sha256: Option<[u8; 32]>,
+    pub sample_hash: Option<[u8; 32]>,
     pub ahash: Option<u64>,
     pub dhash: Option<u64>,
     pub phash: Option<u64>,
@@ -56,6 +57,48 @@ pub struct FileListRow {
     pub file_type: Option<String>,
 }
 
+/// One file present on only one side of a cross-fileset comparison.
+#[derive(Debug, Clone)]
+pub struct FilesetDiffRow {
+    pub path: PathBuf,
+    pub size_bytes: u64,
+    pub file_type: Option<String>,
+    /// A row with different bytes but an identical perceptual hash exists
+    /// on the other side — usually the same image or video re-encoded or
+    /// resized.
+    pub phash_match: bool,
+}
+
+/// Result of comparing two scan databases by content hash; see
+/// `SqliteScanStore::compare_with_fileset`.
+#[derive(Debug, Clone, Default)]
+pub struct FilesetComparison {
+    pub self_label: String,
+    pub other_label: String,
+    /// Rows in this fileset whose blake3 also exists in the other one.
+    pub matched_files: u64,
+    /// Rows without a blake3 on each side; they cannot be compared.
+    pub self_unhashed: u64,
+    pub other_unhashed: u64,
+    pub only_in_self: Vec<FilesetDiffRow>,
+    pub only_in_other: Vec<FilesetDiffRow>,
+}
+
+/// What changed in the persistent match index across one refresh; see
+/// `SqliteScanStore::refresh_match_index`. Keys are the `algo:hex` group
+/// keys stored in the index, so a consumer can patch an existing view
+/// instead of reloading every group.
+#[derive(Debug, Clone, Default)]
+pub struct MatchIndexDelta {
+    /// Group keys that exist after the refresh but did not before. Also
+    /// covers groups whose membership changed, since a changed group is
+    /// dropped and re-added under the same key.
+    pub added: Vec<String>,
+    /// Group keys that existed before the refresh but no longer do.
+    pub removed: Vec<String>,
+    pub total_groups: u64,
+}
+
 #[derive(Debug, Clone)]
 pub struct FilesetMetadata {
     pub created_at: SystemTime,
@@ -72,11 +115,32 @@ pub struct FilesetMetadata {
     pub notes: String,
 }
 
+/// Buckets in a per-stage duration histogram: bucket `i` counts calls
+/// that took `[2^i, 2^(i+1))` microseconds, with the last bucket
+/// absorbing everything slower (~8.4 s and up at 24 buckets).
+pub const SCAN_STAGE_BUCKETS: usize = 24;
+
+/// Timing profile for one scan stage, accumulated across every file the
+/// scan touched. The log2 bucketing is deliberately coarse: it is enough
+/// to tell ffprobe waits from NAS latency from DCT cost without paying
+/// for exact quantiles in the hot path.
+#[derive(Debug, Clone)]
+pub struct StageTiming {
+    /// Stage label, matching the step names progress reporting uses.
+    pub stage: &'static str,
+    pub calls: u64,
+    pub total_micros: u64,
+    pub buckets: [u64; SCAN_STAGE_BUCKETS],
+}
+
 #[derive(Debug, Default, Clone)]
 pub struct ScanStats {
     pub files_seen: u64,
     pub files_hashed: u64,
     pub files_skipped: u64,
+    /// Per-stage duration histograms for the completed scan; empty until
+    /// the scan finishes. Stages that never ran report zero calls.
+    pub stage_timings: Vec<StageTiming>,
 }
 
 #[derive(Debug, Clone)]
@@ -1,14 +1,14 @@
-use std::collections::BTreeMap;
+use std::collections::{BTreeMap, HashMap, HashSet};
 use std::convert::TryInto;
 use std::io::Read;
 use std::path::{Path, PathBuf};
 use std::process::{Command, Stdio};
 use std::sync::{
-    atomic::{AtomicBool, Ordering},
-    mpsc, Arc,
+    atomic::{AtomicBool, AtomicU64, Ordering},
+    mpsc, Arc, Condvar, Mutex, OnceLock,
 };
 use std::thread;
-use std::time::{Duration, Instant, SystemTime};
+use std::time::{Duration, Instant, SystemTime, UNIX_EPOCH};
 
 use image_hasher::{HashAlg, HasherConfig};
 use rayon::prelude::*;
@@ -17,10 +17,10 @@ use walkdir::WalkDir;
 use crate::db::SqliteScanStore;
 use crate::drive;
 use crate::error::{Error, Result};
-use crate::hash::{blake3_file, sha256_file};
+use crate::hash::{multi_hash_file_with_options, sample_hash_file, HashIoBackend};
 use crate::models::{
     DriveMetadata, FileSnapshotRecord, FilesetMetadata, MediaFileRecord, ScanResult, ScanRootKind,
-    ScanStats,
+    ScanStats, StageTiming, SCAN_STAGE_BUCKETS,
 };
 use serde_json::Value;
 use wait_timeout::ChildExt;
@@ -35,6 +35,21 @@ pub struct ScanConfig {
     pub snapshots_per_video: u32,
     pub snapshot_max_dim: u32,
     pub concurrent_processing: bool,
+    pub hash_io_backend: HashIoBackend,
+    /// When set, the walk records only sizes and cheap head/tail sample
+    /// hashes; full blake3/sha256 runs afterwards, restricted to files whose
+    /// (size, sample) collides with another row and which therefore can
+    /// actually be exact duplicates.
+    pub lazy_hashing: bool,
+    /// When set, hashing reads advise the kernel of sequential access and
+    /// drop hashed bytes out of the page cache behind the read cursor, so a
+    /// multi-TB scan stops evicting the working set of colocated services.
+    pub drop_behind_cache: bool,
+    /// When scanning into a DB that already holds rows, skip the expensive
+    /// stages (content hashes, perceptual hashes, ffprobe, snapshots) for
+    /// files whose size and mtime are unchanged since the previous scan, and
+    /// drop rows whose files no longer exist.
+    pub incremental: bool,
 }
 
 impl ScanConfig {
@@ -48,6 +63,10 @@ impl ScanConfig {
             snapshots_per_video: 3,
             snapshot_max_dim: 1024,
             concurrent_processing: true,
+            hash_io_backend: HashIoBackend::Auto,
+            lazy_hashing: false,
+            drop_behind_cache: false,
+            incremental: false,
         }
     }
 }
@@ -96,6 +115,154 @@ pub struct ScanProgress {
     pub active_tasks: Vec<ActiveScanTask>,
 }
 
+/// Maximum entries in a [`ScanProgressBoard`]'s active-task table. Tasks
+/// beyond this simply go unreported until a slot frees up; the table is
+/// for display, not accounting.
+pub const PROGRESS_BOARD_TASK_SLOTS: usize = 32;
+
+struct BoardTask {
+    path: PathBuf,
+    step: &'static str,
+}
+
+/// Grown to at most [`PROGRESS_BOARD_TASK_SLOTS`] and never shrunk; the
+/// first `len` slots are live and the rest keep their `PathBuf`
+/// allocations around, so steady-state updates copy into existing buffers.
+#[derive(Default)]
+struct BoardTaskTable {
+    slots: Vec<BoardTask>,
+    len: usize,
+}
+
+/// Shared progress state a host polls at its own frame rate instead of
+/// receiving a callback per scan event. The scanner stores counters with
+/// plain atomics and rewrites the fixed-capacity active-task table in
+/// place — no per-file allocation or callback marshalling — and bumps
+/// `seq` on every update so pollers can skip redraws when nothing
+/// changed. Counters are independently atomic, so a reader racing an
+/// update may see values from two adjacent updates; for progress display
+/// that is harmless and much cheaper than a fully consistent view.
+#[derive(Default)]
+pub struct ScanProgressBoard {
+    seq: AtomicU64,
+    files_seen: AtomicU64,
+    files_hashed: AtomicU64,
+    files_skipped: AtomicU64,
+    bytes_seen: AtomicU64,
+    total_files: AtomicU64,
+    total_bytes: AtomicU64,
+    tasks: Mutex<BoardTaskTable>,
+}
+
+/// Point-in-time copy of a [`ScanProgressBoard`], produced by
+/// [`ScanProgressBoard::read`].
+#[derive(Debug, Clone, Default)]
+pub struct ScanProgressBoardSnapshot {
+    pub seq: u64,
+    pub files_seen: u64,
+    pub files_hashed: u64,
+    pub files_skipped: u64,
+    pub bytes_seen: u64,
+    pub total_files: u64,
+    pub total_bytes: u64,
+    pub active_tasks: Vec<ActiveScanTask>,
+}
+
+impl ScanProgressBoard {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    fn publish_counters(&self, stats: &ScanStats, bytes_seen: u64, totals: ScanTotals) {
+        self.files_seen.store(stats.files_seen, Ordering::Relaxed);
+        self.files_hashed
+            .store(stats.files_hashed, Ordering::Relaxed);
+        self.files_skipped
+            .store(stats.files_skipped, Ordering::Relaxed);
+        self.bytes_seen.store(bytes_seen, Ordering::Relaxed);
+        self.total_files.store(totals.files, Ordering::Relaxed);
+        self.total_bytes.store(totals.bytes, Ordering::Relaxed);
+        self.seq.fetch_add(1, Ordering::Release);
+    }
+
+    fn task_started(&self, path: &Path, step: &'static str) {
+        let mut tasks = self.tasks.lock().unwrap();
+        let table = &mut *tasks;
+        let len = table.len;
+        for slot in &mut table.slots[..len] {
+            if slot.path == path {
+                slot.step = step;
+                drop(tasks);
+                self.seq.fetch_add(1, Ordering::Release);
+                return;
+            }
+        }
+        if len == PROGRESS_BOARD_TASK_SLOTS {
+            return;
+        }
+        if len == table.slots.len() {
+            table.slots.push(BoardTask {
+                path: path.to_path_buf(),
+                step,
+            });
+        } else {
+            let slot = &mut table.slots[len];
+            let buf = slot.path.as_mut_os_string();
+            buf.clear();
+            buf.push(path.as_os_str());
+            slot.step = step;
+        }
+        table.len = len + 1;
+        drop(tasks);
+        self.seq.fetch_add(1, Ordering::Release);
+    }
+
+    fn task_finished(&self, path: &Path) {
+        let mut tasks = self.tasks.lock().unwrap();
+        let len = tasks.len;
+        if let Some(idx) = tasks.slots[..len].iter().position(|slot| slot.path == path) {
+            tasks.slots.swap(idx, len - 1);
+            tasks.len = len - 1;
+            drop(tasks);
+            self.seq.fetch_add(1, Ordering::Release);
+        }
+    }
+
+    /// Copies the board into an owned snapshot. Allocation happens here,
+    /// on the poller's cadence, never on the scanner's.
+    pub fn read(&self) -> ScanProgressBoardSnapshot {
+        let active_tasks = {
+            let tasks = self.tasks.lock().unwrap();
+            tasks.slots[..tasks.len]
+                .iter()
+                .map(|slot| ActiveScanTask {
+                    path: slot.path.clone(),
+                    step: slot.step.to_string(),
+                })
+                .collect()
+        };
+        ScanProgressBoardSnapshot {
+            seq: self.seq.load(Ordering::Acquire),
+            files_seen: self.files_seen.load(Ordering::Relaxed),
+            files_hashed: self.files_hashed.load(Ordering::Relaxed),
+            files_skipped: self.files_skipped.load(Ordering::Relaxed),
+            bytes_seen: self.bytes_seen.load(Ordering::Relaxed),
+            total_files: self.total_files.load(Ordering::Relaxed),
+            total_bytes: self.total_bytes.load(Ordering::Relaxed),
+            active_tasks,
+        }
+    }
+}
+
+/// Where per-event scan progress goes: a host callback receiving owned
+/// [`ScanProgress`] values, or in-place updates to a shared
+/// [`ScanProgressBoard`]. Board mode skips building the per-event
+/// progress value — and its active-task clone — entirely.
+enum ProgressSink<'a, F> {
+    Callback(F),
+    Board(&'a ScanProgressBoard),
+}
+
 pub fn scan_to_sqlite_with_progress<F>(
     config: &ScanConfig,
     store: &SqliteScanStore,
@@ -108,18 +275,176 @@ where
     scan_to_sqlite_with_progress_and_totals(config, store, cancel, None, on_progress)
 }
 
+/// Continues a scan that was cancelled or killed mid-run. The fileset must be
+/// marked "incomplete"; rows committed by the interrupted run's periodic
+/// flushes double as the prior index, so already-processed files pass the
+/// same size/mtime check an incremental rescan uses and only the remainder
+/// of the tree is reprocessed.
+pub fn resume_scan_to_sqlite_with_progress<F>(
+    config: &ScanConfig,
+    store: &SqliteScanStore,
+    cancel: Option<&ScanCancelToken>,
+    on_progress: F,
+) -> Result<ScanResult>
+where
+    F: FnMut(&ScanProgress),
+{
+    let status = store
+        .get_fileset_metadata()?
+        .map(|meta| meta.status)
+        .unwrap_or_default();
+    if status != "incomplete" {
+        return Err(Error::InvalidArgument(format!(
+            "fileset is not resumable (status: {})",
+            if status.is_empty() { "none" } else { &status }
+        )));
+    }
+
+    let mut config = config.clone();
+    config.incremental = true;
+    scan_to_sqlite_with_progress_and_totals(&config, store, cancel, None, on_progress)
+}
+
 #[derive(Debug, Clone, Copy, Default)]
 pub struct ScanTotals {
     pub files: u64,
     pub bytes: u64,
 }
 
+/// Running totals accumulated by the walker threads when no precomputed
+/// [`ScanTotals`] are supplied; `ScanProgress.total_files`/`total_bytes` then
+/// grow monotonically as discovery runs ahead of processing, instead of
+/// requiring a separate full [`prescan`] walk.
+#[derive(Default)]
+struct DiscoveredTotals {
+    files: AtomicU64,
+    bytes: AtomicU64,
+}
+
+/// The per-file stages whose durations the scan profiles. Indices are
+/// stable and the labels match the step names progress reporting emits,
+/// so a profile line and a progress line for the same work agree.
+#[derive(Clone, Copy)]
+enum ScanStage {
+    Metadata,
+    FileType,
+    Ffprobe,
+    Perceptual,
+    SampleHash,
+    Hashing,
+    Snapshots,
+    DeferredHashing,
+}
+
+const SCAN_STAGE_NAMES: [&str; 8] = [
+    "metadata",
+    "file type",
+    "ffprobe metadata",
+    "ahash/dhash/phash",
+    "sample hash",
+    "hashing",
+    "video snapshots",
+    "deferred hashing",
+];
+
+/// Lock-free per-stage duration histograms shared by every scan worker.
+/// Recording is two relaxed adds plus one relaxed bucket increment, cheap
+/// enough to leave on unconditionally; exact quantiles are reconstructed
+/// well enough from the log2 buckets to tell slow stages apart.
+#[derive(Default)]
+struct ScanStageTimers {
+    stages: [StageAccum; SCAN_STAGE_NAMES.len()],
+}
+
+#[derive(Default)]
+struct StageAccum {
+    calls: AtomicU64,
+    total_micros: AtomicU64,
+    buckets: [AtomicU64; SCAN_STAGE_BUCKETS],
+}
+
+impl ScanStageTimers {
+    fn record(&self, stage: ScanStage, elapsed: Duration) {
+        let micros = elapsed.as_micros().min(u64::MAX as u128) as u64;
+        let accum = &self.stages[stage as usize];
+        accum.calls.fetch_add(1, Ordering::Relaxed);
+        accum.total_micros.fetch_add(micros, Ordering::Relaxed);
+        let bucket = (63 - micros.max(1).leading_zeros() as usize).min(SCAN_STAGE_BUCKETS - 1);
+        accum.buckets[bucket].fetch_add(1, Ordering::Relaxed);
+    }
+
+    fn snapshot(&self) -> Vec<StageTiming> {
+        self.stages
+            .iter()
+            .zip(SCAN_STAGE_NAMES)
+            .map(|(accum, stage)| {
+                let mut buckets = [0u64; SCAN_STAGE_BUCKETS];
+                for (out, bucket) in buckets.iter_mut().zip(&accum.buckets) {
+                    *out = bucket.load(Ordering::Relaxed);
+                }
+                StageTiming {
+                    stage,
+                    calls: accum.calls.load(Ordering::Relaxed),
+                    total_micros: accum.total_micros.load(Ordering::Relaxed),
+                    buckets,
+                }
+            })
+            .collect()
+    }
+}
+
+enum TotalsSource {
+    Fixed(ScanTotals),
+    Discovered(Arc<DiscoveredTotals>),
+}
+
+impl TotalsSource {
+    fn snapshot(&self) -> ScanTotals {
+        match self {
+            TotalsSource::Fixed(totals) => *totals,
+            TotalsSource::Discovered(discovered) => ScanTotals {
+                files: discovered.files.load(Ordering::Relaxed),
+                bytes: discovered.bytes.load(Ordering::Relaxed),
+            },
+        }
+    }
+}
+
 pub fn scan_to_sqlite_with_progress_and_totals<F>(
     config: &ScanConfig,
     store: &SqliteScanStore,
     cancel: Option<&ScanCancelToken>,
     totals: Option<ScanTotals>,
-    mut on_progress: F,
+    on_progress: F,
+) -> Result<ScanResult>
+where
+    F: FnMut(&ScanProgress),
+{
+    let mut sink = ProgressSink::Callback(on_progress);
+    scan_to_sqlite_with_sink(config, store, cancel, totals, &mut sink)
+}
+
+/// Variant of [`scan_to_sqlite_with_progress_and_totals`] that narrates
+/// into a shared [`ScanProgressBoard`] instead of invoking a callback per
+/// event. The host polls the board at its own frame rate; the scan itself
+/// never allocates or marshals progress per file.
+pub fn scan_to_sqlite_with_progress_totals_and_board(
+    config: &ScanConfig,
+    store: &SqliteScanStore,
+    cancel: Option<&ScanCancelToken>,
+    totals: Option<ScanTotals>,
+    board: &ScanProgressBoard,
+) -> Result<ScanResult> {
+    let mut sink = ProgressSink::<fn(&ScanProgress)>::Board(board);
+    scan_to_sqlite_with_sink(config, store, cancel, totals, &mut sink)
+}
+
+fn scan_to_sqlite_with_sink<F>(
+    config: &ScanConfig,
+    store: &SqliteScanStore,
+    cancel: Option<&ScanCancelToken>,
+    totals: Option<ScanTotals>,
+    sink: &mut ProgressSink<'_, F>,
 ) -> Result<ScanResult>
 where
     F: FnMut(&ScanProgress),
@@ -165,14 +490,52 @@ where
     let scan_result = (|| -> Result<ScanResult> {
         store.set_fileset_metadata(&fileset_meta)?;
 
+        // Fresh scans rebuild every row anyway, so drop the hash indexes up
+        // front and build them once at completion instead of updating four
+        // indexes per insert. Incremental runs touch few rows and keep them.
+        let deferred_indexes = !config.incremental;
+        if deferred_indexes {
+            store.defer_hash_indexes()?;
+            // Same idea for the match-index staleness triggers: a bulk
+            // scan would otherwise run one trigger program per inserted
+            // or rehashed row just to bump a counter.
+            store.defer_match_index_triggers()?;
+        }
+
+        let prior = if config.incremental {
+            let index = PriorIndex::load(store)?;
+            if index.by_path.is_empty() {
+                None
+            } else {
+                Some(Arc::new(index))
+            }
+        } else {
+            None
+        };
+
+        let link_cache = Arc::new(LinkHashCache::default());
+        let stage_timers = Arc::new(ScanStageTimers::default());
         let mut stats = ScanStats::default();
         let mut bytes_seen = 0u64;
         let mut files_since_flush = 0u64;
         let mut last_flush = Instant::now();
-        let totals = totals.unwrap_or_default();
+        // With no precomputed totals the walker counts files and bytes as it
+        // discovers them, so a single traversal serves both progress totals
+        // and enumeration.
+        let (totals, discovered) = match totals {
+            Some(totals) => (TotalsSource::Fixed(totals), None),
+            None => {
+                let discovered = Arc::new(DiscoveredTotals::default());
+                (
+                    TotalsSource::Discovered(Arc::clone(&discovered)),
+                    Some(discovered),
+                )
+            }
+        };
         let mut batch = Vec::with_capacity(SCAN_BATCH_FILES);
         let mut last_batch_flush = Instant::now();
-        for entry in WalkDir::new(&config.root).follow_links(false).into_iter() {
+        let walk_rx = spawn_parallel_walk(&config.root, walk_thread_count(config), discovered);
+        for event in walk_rx.iter() {
             if let Some(cancel) = cancel {
                 if cancel.is_cancelled() {
                     update_fileset_status(store, config, "incomplete");
@@ -181,23 +544,16 @@ where
                 }
             }
 
-            let entry = match entry {
-                Ok(v) => v,
-                Err(_) => {
+            let candidate = match event {
+                WalkEvent::File(candidate) => candidate,
+                WalkEvent::Unreadable => {
                     stats.files_skipped += 1;
                     continue;
                 }
             };
 
-            if !entry.file_type().is_file() {
-                continue;
-            }
-
             stats.files_seen += 1;
-            batch.push(ScanCandidate {
-                path: entry.path().to_path_buf(),
-                is_symlink: entry.file_type().is_symlink(),
-            });
+            batch.push(candidate);
 
             if batch.len() >= SCAN_BATCH_FILES
                 || (!batch.is_empty() && last_batch_flush.elapsed() >= SCAN_PROGRESS_TICK)
@@ -207,7 +563,10 @@ where
                     store,
                     cancel,
                     &totals,
-                    &mut on_progress,
+                    prior.as_ref(),
+                    &link_cache,
+                    &stage_timers,
+                    sink,
                     &mut stats,
                     &mut bytes_seen,
                     &mut files_since_flush,
@@ -225,7 +584,10 @@ where
                 store,
                 cancel,
                 &totals,
-                &mut on_progress,
+                prior.as_ref(),
+                &link_cache,
+                &stage_timers,
+                sink,
                 &mut stats,
                 &mut bytes_seen,
                 &mut files_since_flush,
@@ -236,7 +598,34 @@ where
             )?;
         }
 
+        // Rows whose files vanished since the previous scan would otherwise
+        // linger and pollute duplicate results.
+        if let Some(prior) = prior.as_ref() {
+            for stale in prior.stale_paths() {
+                let _ = store.delete_file_by_path(&stale);
+            }
+        }
+
+        if config.lazy_hashing && config.hash_files {
+            run_deferred_hash_pass(
+                config,
+                store,
+                cancel,
+                &totals,
+                bytes_seen,
+                &stage_timers,
+                sink,
+                &mut stats,
+            )?;
+        }
+
+        if deferred_indexes {
+            store.ensure_hash_indexes()?;
+            store.ensure_match_index_triggers()?;
+        }
+
         update_fileset_status(store, config, "completed");
+        stats.stage_timings = stage_timers.snapshot();
         Ok(ScanResult { stats })
     })();
 
@@ -258,6 +647,268 @@ struct ScanCandidate {
     is_symlink: bool,
 }
 
+struct PriorFile {
+    size_bytes: u64,
+    modified_at_secs: Option<i64>,
+}
+
+/// Rows loaded from a previous scan of the same DB. Incremental rescans use
+/// it to skip the expensive stages for files whose size and mtime are
+/// unchanged, and to prune rows whose files are gone. Workers mark every
+/// visited path so the prune only removes paths the walk never reached.
+struct PriorIndex {
+    by_path: HashMap<PathBuf, PriorFile>,
+    seen: Mutex<HashSet<PathBuf>>,
+}
+
+impl PriorIndex {
+    fn load(store: &SqliteScanStore) -> Result<Self> {
+        let mut by_path = HashMap::new();
+        for (path, size_bytes, modified_at_secs) in store.list_file_identities()? {
+            by_path.insert(
+                path,
+                PriorFile {
+                    size_bytes,
+                    modified_at_secs,
+                },
+            );
+        }
+        Ok(Self {
+            by_path,
+            seen: Mutex::new(HashSet::new()),
+        })
+    }
+
+    fn mark_seen(&self, rel: &Path) {
+        self.seen.lock().unwrap().insert(rel.to_path_buf());
+    }
+
+    /// Unchanged means same size and same mtime at the seconds granularity
+    /// the DB stores. A missing mtime on either side counts as changed.
+    fn is_unchanged(&self, rel: &Path, size_bytes: u64, modified_at: Option<SystemTime>) -> bool {
+        let Some(prior) = self.by_path.get(rel) else {
+            return false;
+        };
+        if prior.size_bytes != size_bytes {
+            return false;
+        }
+        let (Some(prior_secs), Some(current)) = (prior.modified_at_secs, modified_at) else {
+            return false;
+        };
+        let current_secs = current
+            .duration_since(UNIX_EPOCH)
+            .unwrap_or(Duration::from_secs(0))
+            .as_secs() as i64;
+        prior_secs == current_secs
+    }
+
+    fn stale_paths(&self) -> Vec<PathBuf> {
+        let seen = self.seen.lock().unwrap();
+        self.by_path
+            .keys()
+            .filter(|path| !seen.contains(*path))
+            .cloned()
+            .collect()
+    }
+}
+
+/// Hashes computed for a multiply-linked inode, shared by all of its links.
+#[derive(Clone, Default)]
+struct LinkHashes {
+    blake3: Option<[u8; 32]>,
+    sha256: Option<[u8; 32]>,
+    sample_hash: Option<[u8; 32]>,
+    ahash: Option<u64>,
+    dhash: Option<u64>,
+    phash: Option<u64>,
+}
+
+/// Per-scan (device, inode) → hashes cache for hardlinked files.
+///
+/// Hardlinks used to be skipped outright, so rsnapshot-style backup trees —
+/// which are almost entirely hardlinks — ended up with no hashes and never
+/// matched anything. With the cache the first link of an inode pays the
+/// physical read and every other link copies its hashes for free. Only
+/// inodes with nlink > 1 are keyed, so trees without hardlinks cost one
+/// hash-map miss per file at most.
+#[derive(Default)]
+struct LinkHashCache {
+    map: Mutex<HashMap<(u64, u64), LinkHashes>>,
+}
+
+impl LinkHashCache {
+    fn get(&self, key: (u64, u64)) -> Option<LinkHashes> {
+        self.map.lock().ok()?.get(&key).cloned()
+    }
+
+    fn insert(&self, key: (u64, u64), hashes: LinkHashes) {
+        if let Ok(mut map) = self.map.lock() {
+            map.insert(key, hashes);
+        }
+    }
+}
+
+/// Cache key for a file that shares its inode with other links; `None` for
+/// singly-linked files and on platforms without stable (dev, ino) pairs.
+fn hardlink_key(md: &std::fs::Metadata) -> Option<(u64, u64)> {
+    #[cfg(unix)]
+    {
+        use std::os::unix::fs::MetadataExt;
+        if md.nlink() > 1 {
+            return Some((md.dev(), md.ino()));
+        }
+        None
+    }
+    #[cfg(windows)]
+    {
+        let _ = md;
+        None
+    }
+}
+
+enum WalkEvent {
+    File(ScanCandidate),
+    /// A directory or entry that could not be read; counted as skipped,
+    /// matching how walkdir errors were handled before.
+    Unreadable,
+}
+
+/// Shared work queue for the parallel walker: pending directories plus the
+/// number of directories currently being read. The walk is finished when the
+/// queue is empty and no reader is in flight.
+struct WalkQueue {
+    state: Mutex<WalkQueueState>,
+    ready: Condvar,
+}
+
+struct WalkQueueState {
+    pending: Vec<PathBuf>,
+    in_flight: usize,
+    stopped: bool,
+}
+
+/// Upper bound on enumeration threads. Directory listing is latency-bound
+/// rather than CPU-bound (especially on network mounts), but fanning too wide
+/// just queues requests at the server.
+const MAX_WALK_THREADS: usize = 8;
+
+fn walk_thread_count(config: &ScanConfig) -> usize {
+    if !effective_concurrency_enabled(config) {
+        return 1;
+    }
+    thread::available_parallelism()
+        .map(|n| n.get())
+        .unwrap_or(1)
+        .min(MAX_WALK_THREADS)
+}
+
+/// Walks `root` with `threads` directory readers stealing subdirectories from
+/// a shared queue, streaming regular files to the returned channel. Symlinks
+/// are not followed, matching the previous `WalkDir` configuration. Entry
+/// order is nondeterministic. Readers exit on their own once the receiver is
+/// dropped or the tree is exhausted.
+fn spawn_parallel_walk(
+    root: &Path,
+    threads: usize,
+    discovered: Option<Arc<DiscoveredTotals>>,
+) -> mpsc::Receiver<WalkEvent> {
+    let (tx, rx) = mpsc::channel::<WalkEvent>();
+    let queue = Arc::new(WalkQueue {
+        state: Mutex::new(WalkQueueState {
+            pending: vec![root.to_path_buf()],
+            in_flight: 0,
+            stopped: false,
+        }),
+        ready: Condvar::new(),
+    });
+
+    for _ in 0..threads.max(1) {
+        let queue = Arc::clone(&queue);
+        let tx = tx.clone();
+        let discovered = discovered.clone();
+        thread::spawn(move || walk_worker(&queue, &tx, discovered.as_deref()));
+    }
+
+    rx
+}
+
+fn walk_worker(
+    queue: &WalkQueue,
+    tx: &mpsc::Sender<WalkEvent>,
+    discovered: Option<&DiscoveredTotals>,
+) {
+    loop {
+        let dir = {
+            let mut state = queue.state.lock().unwrap();
+            loop {
+                if state.stopped {
+                    return;
+                }
+                if let Some(dir) = state.pending.pop() {
+                    state.in_flight += 1;
+                    break dir;
+                }
+                if state.in_flight == 0 {
+                    // Nothing queued and nobody can queue more: walk is done.
+                    queue.ready.notify_all();
+                    return;
+                }
+                state = queue.ready.wait(state).unwrap();
+            }
+        };
+
+        let mut subdirs = Vec::new();
+        let mut send_failed = false;
+        match std::fs::read_dir(&dir) {
+            Ok(entries) => {
+                for entry in entries {
+                    let Ok(entry) = entry else {
+                        send_failed |= tx.send(WalkEvent::Unreadable).is_err();
+                        continue;
+                    };
+                    // DirEntry::file_type does not traverse symlinks, so links
+                    // are neither descended into nor reported as files.
+                    let Ok(file_type) = entry.file_type() else {
+                        send_failed |= tx.send(WalkEvent::Unreadable).is_err();
+                        continue;
+                    };
+                    if file_type.is_dir() {
+                        subdirs.push(entry.path());
+                    } else if file_type.is_file() {
+                        if let Some(discovered) = discovered {
+                            let len = entry.metadata().map(|md| md.len()).unwrap_or(0);
+                            discovered.files.fetch_add(1, Ordering::Relaxed);
+                            discovered.bytes.fetch_add(len, Ordering::Relaxed);
+                        }
+                        send_failed |= tx
+                            .send(WalkEvent::File(ScanCandidate {
+                                path: entry.path(),
+                                is_symlink: false,
+                            }))
+                            .is_err();
+                    }
+                    if send_failed {
+                        break;
+                    }
+                }
+            }
+            Err(_) => {
+                send_failed = tx.send(WalkEvent::Unreadable).is_err();
+            }
+        }
+
+        let mut state = queue.state.lock().unwrap();
+        state.in_flight -= 1;
+        if send_failed {
+            // Receiver is gone (scan cancelled or errored); unblock everyone.
+            state.stopped = true;
+        } else {
+            state.pending.append(&mut subdirs);
+        }
+        queue.ready.notify_all();
+    }
+}
+
 struct ProcessedScanItem {
     path: PathBuf,
     rec: Option<MediaFileRecord>,
@@ -277,8 +928,11 @@ fn flush_scan_batch<F>(
     config: &ScanConfig,
     store: &SqliteScanStore,
     cancel: Option<&ScanCancelToken>,
-    totals: &ScanTotals,
-    on_progress: &mut F,
+    totals: &TotalsSource,
+    prior: Option<&Arc<PriorIndex>>,
+    link_cache: &Arc<LinkHashCache>,
+    stage_timers: &Arc<ScanStageTimers>,
+    sink: &mut ProgressSink<'_, F>,
     stats: &mut ScanStats,
     bytes_seen: &mut u64,
     files_since_flush: &mut u64,
@@ -303,18 +957,37 @@ where
         let (tx, rx) = mpsc::channel::<WorkerUpdate>();
         let mut cancelled = false;
         let mut last_heartbeat = Instant::now();
+        // Completed records are buffered and written after the workers drain,
+        // so SQLite writes stop serializing against progress handling, and
+        // records without snapshots can go through the multi-row upsert.
+        let mut pending_writes: Vec<(MediaFileRecord, Option<Vec<FileSnapshotRecord>>)> =
+            Vec::with_capacity(target);
 
         let cfg = config.clone();
+        let prior_for_workers = prior.cloned();
+        let cache_for_workers = Arc::clone(link_cache);
+        let timers_for_workers = Arc::clone(stage_timers);
         let handle = thread::spawn(move || {
-            candidates.into_par_iter().for_each(|candidate| {
-                let tx_item = tx.clone();
-                let item = process_scan_candidate(&cfg, candidate, |path, step| {
-                    let _ = tx_item.send(WorkerUpdate::Stage {
-                        path: path.to_path_buf(),
-                        step,
-                    });
+            // Candidates fan out on the I/O pool; the compute stages inside
+            // hop to the CPU pool via run_cpu.
+            scan_pools().io.install(|| {
+                candidates.into_par_iter().for_each(|candidate| {
+                    let tx_item = tx.clone();
+                    let item = process_scan_candidate(
+                        &cfg,
+                        prior_for_workers.as_deref(),
+                        &cache_for_workers,
+                        &timers_for_workers,
+                        candidate,
+                        |path, step| {
+                            let _ = tx_item.send(WorkerUpdate::Stage {
+                                path: path.to_path_buf(),
+                                step,
+                            });
+                        },
+                    );
+                    let _ = tx_item.send(WorkerUpdate::Done(item));
                 });
-                let _ = tx_item.send(WorkerUpdate::Done(item));
             });
         });
 
@@ -329,22 +1002,24 @@ where
                 Ok(v) => v,
                 Err(mpsc::RecvTimeoutError::Timeout) => {
                     if last_heartbeat.elapsed() >= CONCURRENT_PROGRESS_HEARTBEAT {
-                        let (path, step) = active_tasks
-                            .iter()
-                            .next()
-                            .map(|(p, s)| (p.clone(), Some(s.clone())))
-                            .unwrap_or_else(|| (PathBuf::new(), Some("scan".to_string())));
-                        on_progress(&ScanProgress {
-                            files_seen: stats.files_seen,
-                            files_hashed: stats.files_hashed,
-                            files_skipped: stats.files_skipped,
-                            bytes_seen: *bytes_seen,
-                            total_files: totals.files,
-                            total_bytes: totals.bytes,
-                            current_path: path,
-                            current_step: step,
-                            active_tasks: active_task_list(&active_tasks),
-                        });
+                        if let ProgressSink::Callback(on_progress) = sink {
+                            let (path, step) = active_tasks
+                                .iter()
+                                .next()
+                                .map(|(p, s)| (p.clone(), Some(s.clone())))
+                                .unwrap_or_else(|| (PathBuf::new(), Some("scan".to_string())));
+                            on_progress(&ScanProgress {
+                                files_seen: stats.files_seen,
+                                files_hashed: stats.files_hashed,
+                                files_skipped: stats.files_skipped,
+                                bytes_seen: *bytes_seen,
+                                total_files: totals.snapshot().files,
+                                total_bytes: totals.snapshot().bytes,
+                                current_path: path,
+                                current_step: step,
+                                active_tasks: active_task_list(&active_tasks),
+                            });
+                        }
                         last_heartbeat = Instant::now();
                     }
                     continue;
@@ -354,23 +1029,36 @@ where
 
             match msg {
                 WorkerUpdate::Stage { path, step } => {
-                    active_tasks.insert(path.clone(), step.to_string());
-                    on_progress(&ScanProgress {
-                        files_seen: stats.files_seen,
-                        files_hashed: stats.files_hashed,
-                        files_skipped: stats.files_skipped,
-                        bytes_seen: *bytes_seen,
-                        total_files: totals.files,
-                        total_bytes: totals.bytes,
-                        current_path: path,
-                        current_step: Some(step.to_string()),
-                        active_tasks: active_task_list(&active_tasks),
-                    });
+                    match sink {
+                        ProgressSink::Callback(on_progress) => {
+                            active_tasks.insert(path.clone(), step.to_string());
+                            on_progress(&ScanProgress {
+                                files_seen: stats.files_seen,
+                                files_hashed: stats.files_hashed,
+                                files_skipped: stats.files_skipped,
+                                bytes_seen: *bytes_seen,
+                                total_files: totals.snapshot().files,
+                                total_bytes: totals.snapshot().bytes,
+                                current_path: path,
+                                current_step: Some(step.to_string()),
+                                active_tasks: active_task_list(&active_tasks),
+                            });
+                        }
+                        ProgressSink::Board(board) => {
+                            board.task_started(&path, step);
+                            board.publish_counters(stats, *bytes_seen, totals.snapshot());
+                        }
+                    }
                     last_heartbeat = Instant::now();
                 }
                 WorkerUpdate::Done(item) => {
                     completed = completed.saturating_add(1);
-                    active_tasks.remove(&item.path);
+                    match sink {
+                        ProgressSink::Callback(_) => {
+                            active_tasks.remove(&item.path);
+                        }
+                        ProgressSink::Board(board) => board.task_finished(&item.path),
+                    }
 
                     if cancelled {
                         continue;
@@ -381,61 +1069,96 @@ where
                     stats.files_skipped =
                         stats.files_skipped.saturating_add(item.files_skipped_inc);
 
-                    if let Some(mut rec) = item.rec {
-                        let file_id = store.upsert_file(&rec)?;
-                        rec.file_id = Some(file_id);
-                        if let Some(snaps) = item.snapshots {
-                            let _ = store.replace_file_snapshots(file_id, &snaps);
-                        }
+                    if let Some(rec) = item.rec {
+                        pending_writes.push((rec, item.snapshots));
                     }
 
-                    on_progress(&ScanProgress {
-                        files_seen: stats.files_seen,
-                        files_hashed: stats.files_hashed,
-                        files_skipped: stats.files_skipped,
-                        bytes_seen: *bytes_seen,
-                        total_files: totals.files,
-                        total_bytes: totals.bytes,
-                        current_path: item.path.clone(),
-                        current_step: Some("done".to_string()),
-                        active_tasks: active_task_list(&active_tasks),
-                    });
-                    last_heartbeat = Instant::now();
-
-                    *files_since_flush = files_since_flush.saturating_add(1);
-                    if *files_since_flush >= flush_every_files
-                        || last_flush.elapsed() >= flush_every_elapsed
-                    {
-                        store.commit_tx()?;
-                        store.begin_scan_write_optimized_tx()?;
-                        *files_since_flush = 0;
-                        *last_flush = Instant::now();
+                    match sink {
+                        ProgressSink::Callback(on_progress) => {
+                            on_progress(&ScanProgress {
+                                files_seen: stats.files_seen,
+                                files_hashed: stats.files_hashed,
+                                files_skipped: stats.files_skipped,
+                                bytes_seen: *bytes_seen,
+                                total_files: totals.snapshot().files,
+                                total_bytes: totals.snapshot().bytes,
+                                current_path: item.path.clone(),
+                                current_step: Some("done".to_string()),
+                                active_tasks: active_task_list(&active_tasks),
+                            });
+                        }
+                        ProgressSink::Board(board) => {
+                            board.publish_counters(stats, *bytes_seen, totals.snapshot());
+                        }
                     }
+                    last_heartbeat = Instant::now();
                 }
             }
         }
         let _ = handle.join();
 
+        // Items completed before a cancellation still get written, matching
+        // the old inline-write behavior.
+        let mut batch_recs = Vec::with_capacity(pending_writes.len());
+        for (rec, snapshots) in pending_writes {
+            match snapshots {
+                Some(snaps) => {
+                    let file_id = store.upsert_file(&rec)?;
+                    let _ = store.replace_file_snapshots(file_id, &snaps);
+                }
+                None => batch_recs.push(rec),
+            }
+            *files_since_flush = files_since_flush.saturating_add(1);
+        }
+        store.upsert_files_batch(&batch_recs)?;
+
         if cancelled {
             update_fileset_status(store, config, "incomplete");
             store.commit_tx()?;
             return Err(Error::Cancelled);
         }
+
+        if *files_since_flush >= flush_every_files || last_flush.elapsed() >= flush_every_elapsed {
+            store.commit_tx()?;
+            store.begin_scan_write_optimized_tx()?;
+            *files_since_flush = 0;
+            *last_flush = Instant::now();
+        }
     } else {
         for candidate in candidates {
-            let item = process_scan_candidate(config, candidate, |path, step| {
-                on_progress(&ScanProgress {
-                    files_seen: stats.files_seen,
-                    files_hashed: stats.files_hashed,
-                    files_skipped: stats.files_skipped,
-                    bytes_seen: *bytes_seen,
-                    total_files: totals.files,
-                    total_bytes: totals.bytes,
-                    current_path: path.to_path_buf(),
-                    current_step: Some(step.to_string()),
-                    active_tasks: Vec::new(),
-                });
-            });
+            let item = match sink {
+                ProgressSink::Callback(on_progress) => process_scan_candidate(
+                    config,
+                    prior.map(Arc::as_ref),
+                    link_cache,
+                    stage_timers,
+                    candidate,
+                    |path, step| {
+                        on_progress(&ScanProgress {
+                            files_seen: stats.files_seen,
+                            files_hashed: stats.files_hashed,
+                            files_skipped: stats.files_skipped,
+                            bytes_seen: *bytes_seen,
+                            total_files: totals.snapshot().files,
+                            total_bytes: totals.snapshot().bytes,
+                            current_path: path.to_path_buf(),
+                            current_step: Some(step.to_string()),
+                            active_tasks: Vec::new(),
+                        });
+                    },
+                ),
+                ProgressSink::Board(board) => process_scan_candidate(
+                    config,
+                    prior.map(Arc::as_ref),
+                    link_cache,
+                    stage_timers,
+                    candidate,
+                    |path, step| {
+                        board.task_started(path, step);
+                        board.publish_counters(stats, *bytes_seen, totals.snapshot());
+                    },
+                ),
+            };
 
             if let Some(cancel) = cancel {
                 if cancel.is_cancelled() {
@@ -457,17 +1180,25 @@ where
                 }
             }
 
-            on_progress(&ScanProgress {
-                files_seen: stats.files_seen,
-                files_hashed: stats.files_hashed,
-                files_skipped: stats.files_skipped,
-                bytes_seen: *bytes_seen,
-                total_files: totals.files,
-                total_bytes: totals.bytes,
-                current_path: item.path.clone(),
-                current_step: Some("done".to_string()),
-                active_tasks: Vec::new(),
-            });
+            match sink {
+                ProgressSink::Callback(on_progress) => {
+                    on_progress(&ScanProgress {
+                        files_seen: stats.files_seen,
+                        files_hashed: stats.files_hashed,
+                        files_skipped: stats.files_skipped,
+                        bytes_seen: *bytes_seen,
+                        total_files: totals.snapshot().files,
+                        total_bytes: totals.snapshot().bytes,
+                        current_path: item.path.clone(),
+                        current_step: Some("done".to_string()),
+                        active_tasks: Vec::new(),
+                    });
+                }
+                ProgressSink::Board(board) => {
+                    board.task_finished(&item.path);
+                    board.publish_counters(stats, *bytes_seen, totals.snapshot());
+                }
+            }
 
             *files_since_flush = files_since_flush.saturating_add(1);
             if *files_since_flush >= flush_every_files
@@ -484,6 +1215,92 @@ where
     Ok(())
 }
 
+/// Second phase of a lazy-hashing scan: full-hash only the rows whose
+/// (size, sample_hash) collides with another row, writing the results back
+/// into the already-committed `files` rows.
+#[allow(clippy::too_many_arguments)]
+fn run_deferred_hash_pass<F>(
+    config: &ScanConfig,
+    store: &SqliteScanStore,
+    cancel: Option<&ScanCancelToken>,
+    totals: &TotalsSource,
+    bytes_seen: u64,
+    stage_timers: &Arc<ScanStageTimers>,
+    sink: &mut ProgressSink<'_, F>,
+    stats: &mut ScanStats,
+) -> Result<()>
+where
+    F: FnMut(&ScanProgress),
+{
+    const DEFERRED_CHUNK_FILES: usize = 32;
+
+    let candidates = store.list_deferred_hash_candidates()?;
+    if candidates.is_empty() {
+        return Ok(());
+    }
+
+    for chunk in candidates.chunks(DEFERRED_CHUNK_FILES) {
+        if let Some(cancel) = cancel {
+            if cancel.is_cancelled() {
+                update_fileset_status(store, config, "incomplete");
+                store.commit_tx()?;
+                return Err(Error::Cancelled);
+            }
+        }
+
+        let backend = config.hash_io_backend;
+        let drop_behind = config.drop_behind_cache;
+        let root = config.root.clone();
+        let hash_one = |(file_id, path): &(i64, PathBuf)| {
+            let abs = root.join(path);
+            let stage_start = Instant::now();
+            let hashes = multi_hash_file_with_options(&abs, backend, drop_behind).ok();
+            stage_timers.record(ScanStage::DeferredHashing, stage_start.elapsed());
+            (*file_id, path.clone(), hashes)
+        };
+        let hashed: Vec<_> = if effective_concurrency_enabled(config) {
+            // Pure hashing work, so it runs on the CPU pool directly.
+            scan_pools()
+                .cpu
+                .install(|| chunk.par_iter().map(hash_one).collect())
+        } else {
+            chunk.iter().map(hash_one).collect()
+        };
+
+        for (file_id, path, hashes) in hashed {
+            match hashes {
+                Some(hashes) => {
+                    store.update_file_content_hashes(file_id, &hashes.blake3, &hashes.sha256)?;
+                    stats.files_hashed = stats.files_hashed.saturating_add(1);
+                }
+                None => {
+                    stats.files_skipped = stats.files_skipped.saturating_add(1);
+                }
+            }
+            match sink {
+                ProgressSink::Callback(on_progress) => {
+                    on_progress(&ScanProgress {
+                        files_seen: stats.files_seen,
+                        files_hashed: stats.files_hashed,
+                        files_skipped: stats.files_skipped,
+                        bytes_seen,
+                        total_files: totals.snapshot().files,
+                        total_bytes: totals.snapshot().bytes,
+                        current_path: path,
+                        current_step: Some("deferred hashing".to_string()),
+                        active_tasks: Vec::new(),
+                    });
+                }
+                ProgressSink::Board(board) => {
+                    board.publish_counters(stats, bytes_seen, totals.snapshot());
+                }
+            }
+        }
+    }
+
+    Ok(())
+}
+
 fn active_task_list(active: &BTreeMap<PathBuf, String>) -> Vec<ActiveScanTask> {
     active
         .iter()
@@ -496,6 +1313,9 @@ fn active_task_list(active: &BTreeMap<PathBuf, String>) -> Vec<ActiveScanTask> {
 
 fn process_scan_candidate<F>(
     config: &ScanConfig,
+    prior: Option<&PriorIndex>,
+    link_cache: &LinkHashCache,
+    timers: &ScanStageTimers,
     candidate: ScanCandidate,
     mut on_stage: F,
 ) -> ProcessedScanItem
@@ -504,7 +1324,10 @@ where
 {
     let path = candidate.path;
     on_stage(&path, "metadata");
-    let md = match std::fs::metadata(&path) {
+    let stage_start = Instant::now();
+    let md = std::fs::metadata(&path);
+    timers.record(ScanStage::Metadata, stage_start.elapsed());
+    let md = match md {
         Ok(v) => v,
         Err(_) => {
             return ProcessedScanItem {
@@ -518,15 +1341,42 @@ where
         }
     };
 
-    let linked_file = candidate.is_symlink || is_hardlinked_file(&md);
+    let rel_path = relative_to_root(&config.root, &path).unwrap_or(path.clone());
+    if let Some(prior) = prior {
+        prior.mark_seen(&rel_path);
+        if prior.is_unchanged(&rel_path, md.len(), md.modified().ok()) {
+            // The existing row stays as-is; only the prune pass cares that
+            // this path was visited.
+            on_stage(&path, "unchanged");
+            return ProcessedScanItem {
+                path,
+                rec: None,
+                snapshots: None,
+                bytes_seen: md.len(),
+                files_hashed_inc: 0,
+                files_skipped_inc: 0,
+            };
+        }
+    }
+
+    // Symlinks get no hashes, as before. Hardlinks go through the inode
+    // cache: a hit copies the hashes computed for the first link, a miss
+    // hashes normally and seeds the cache for the remaining links.
+    let link_key = if candidate.is_symlink {
+        None
+    } else {
+        hardlink_key(&md)
+    };
+    let cached_link = link_key.and_then(|key| link_cache.get(key));
     on_stage(&path, "file type");
     let mut rec = MediaFileRecord {
         file_id: None,
-        path: relative_to_root(&config.root, &path).unwrap_or(path.clone()),
+        path: rel_path,
         size_bytes: md.len(),
         modified_at: md.modified().ok(),
         blake3: None,
         sha256: None,
+        sample_hash: None,
         ahash: None,
         dhash: None,
         phash: None,
@@ -534,62 +1384,113 @@ where
         file_type: None,
     };
 
+    let stage_start = Instant::now();
     rec.file_type = match infer::get_from_path(&path) {
         Ok(Some(kind)) => Some(kind.mime_type().to_string()),
         Ok(None) => None,
         Err(_) => None,
     };
+    timers.record(ScanStage::FileType, stage_start.elapsed());
     if is_ffprobe_candidate(&path, rec.file_type.as_deref()) {
         on_stage(&path, "ffprobe metadata");
+        let stage_start = Instant::now();
         rec.ffmpeg_metadata = ffprobe_metadata(&path);
+        timers.record(ScanStage::Ffprobe, stage_start.elapsed());
     }
 
-    if config.perceptual_hashes && !linked_file && is_image_file(&path, rec.file_type.as_deref()) {
-        on_stage(&path, "ahash/dhash/phash");
-        if let Some((ahash, dhash, phash)) = image_hashes_from_path(&path) {
-            rec.ahash = Some(ahash);
-            rec.dhash = Some(dhash);
-            rec.phash = Some(phash);
+    if config.perceptual_hashes
+        && !candidate.is_symlink
+        && is_image_file(&path, rec.file_type.as_deref())
+    {
+        if let Some(cached) = &cached_link {
+            rec.ahash = cached.ahash;
+            rec.dhash = cached.dhash;
+            rec.phash = cached.phash;
+        } else {
+            on_stage(&path, "ahash/dhash/phash");
+            let stage_start = Instant::now();
+            let hashes = run_cpu(config, || image_hashes_from_path(&path));
+            timers.record(ScanStage::Perceptual, stage_start.elapsed());
+            if let Some((ahash, dhash, phash)) = hashes {
+                rec.ahash = Some(ahash);
+                rec.dhash = Some(dhash);
+                rec.phash = Some(phash);
+            }
         }
     }
 
     let mut files_hashed_inc = 0_u64;
     let mut files_skipped_inc = 0_u64;
-    if config.hash_files && !linked_file {
-        on_stage(&path, "blake3");
-        match blake3_file(&path) {
-            Ok(hash) => {
-                rec.blake3 = Some(hash);
-            }
-            Err(_) => {
-                files_skipped_inc = files_skipped_inc.saturating_add(1);
-            }
-        }
-        on_stage(&path, "sha256");
-        match sha256_file(&path) {
-            Ok(hash) => {
-                rec.sha256 = Some(hash);
+    if config.hash_files && !candidate.is_symlink {
+        if let Some(cached) = &cached_link {
+            on_stage(&path, "hardlink cache");
+            rec.sample_hash = cached.sample_hash;
+            rec.blake3 = cached.blake3;
+            rec.sha256 = cached.sha256;
+            if rec.blake3.is_some() || rec.sha256.is_some() {
                 files_hashed_inc = files_hashed_inc.saturating_add(1);
             }
-            Err(_) => {
-                files_skipped_inc = files_skipped_inc.saturating_add(1);
+        } else if config.lazy_hashing {
+            // Full hashes are filled in later by the deferred pass, and only
+            // for files whose size/sample collides with another row.
+            on_stage(&path, "sample hash");
+            let stage_start = Instant::now();
+            rec.sample_hash = sample_hash_file(&path).ok();
+            timers.record(ScanStage::SampleHash, stage_start.elapsed());
+        } else {
+            on_stage(&path, "hashing");
+            let stage_start = Instant::now();
+            let hashes = run_cpu(config, || {
+                multi_hash_file_with_options(
+                    &path,
+                    config.hash_io_backend,
+                    config.drop_behind_cache,
+                )
+            });
+            timers.record(ScanStage::Hashing, stage_start.elapsed());
+            match hashes {
+                Ok(hashes) => {
+                    rec.blake3 = Some(hashes.blake3);
+                    rec.sha256 = Some(hashes.sha256);
+                    files_hashed_inc = files_hashed_inc.saturating_add(1);
+                }
+                Err(_) => {
+                    files_skipped_inc = files_skipped_inc.saturating_add(1);
+                }
             }
         }
     }
 
+    if let (Some(key), None) = (link_key, &cached_link) {
+        link_cache.insert(
+            key,
+            LinkHashes {
+                blake3: rec.blake3,
+                sha256: rec.sha256,
+                sample_hash: rec.sample_hash,
+                ahash: rec.ahash,
+                dhash: rec.dhash,
+                phash: rec.phash,
+            },
+        );
+    }
+
     let mut snapshots = None;
     if config.capture_snapshots && config.snapshots_per_video > 0 {
         let is_video = is_video_file(&path, rec.file_type.as_deref());
         let duration_ms = rec.ffmpeg_metadata.as_deref().and_then(ffprobe_duration_ms);
         if is_video && duration_ms.is_some() {
             on_stage(&path, "video snapshots");
+            let stage_start = Instant::now();
             snapshots = video_snapshots_for_file(
                 &path,
                 duration_ms,
                 config.snapshots_per_video,
                 config.snapshot_max_dim,
                 Duration::from_secs(30),
+                effective_concurrency_enabled(config),
             );
+            timers.record(ScanStage::Snapshots, stage_start.elapsed());
         }
     }
 
@@ -603,16 +1504,53 @@ where
     }
 }
 
-fn is_hardlinked_file(md: &std::fs::Metadata) -> bool {
-    #[cfg(unix)]
-    {
-        use std::os::unix::fs::MetadataExt;
-        return md.nlink() > 1;
-    }
-    #[cfg(windows)]
-    {
-        let _ = md;
-        false
+/// Upper bound on the I/O pool; past this, extra in-flight requests stop
+/// helping even wide NAS arrays and just inflate memory and context
+/// switches.
+const MAX_IO_WORKERS: usize = 32;
+
+/// Worker pools for the two classes of per-file scan work.
+///
+/// One shared pool sized for cores starves as soon as its threads park in
+/// ffprobe replies, snapshot captures, or cold NAS reads — the pool fills
+/// with blocked tasks while blake3/sha256/DCT work queues behind them. The
+/// I/O pool is oversubscribed so blocked threads cost nothing but a stack;
+/// the CPU pool is sized to cores and runs only compute, handed over from
+/// I/O workers via [`run_cpu`], so the cores stay saturated no matter how
+/// many probes are in flight.
+struct ScanPools {
+    io: rayon::ThreadPool,
+    cpu: rayon::ThreadPool,
+}
+
+fn scan_pools() -> &'static ScanPools {
+    static POOLS: OnceLock<ScanPools> = OnceLock::new();
+    POOLS.get_or_init(|| {
+        let cores = thread::available_parallelism()
+            .map(|n| n.get())
+            .unwrap_or(4);
+        let io = rayon::ThreadPoolBuilder::new()
+            .num_threads((cores * 2).min(MAX_IO_WORKERS))
+            .thread_name(|i| format!("ddn-scan-io-{i}"))
+            .build()
+            .expect("failed to build scan I/O pool");
+        let cpu = rayon::ThreadPoolBuilder::new()
+            .num_threads(cores)
+            .thread_name(|i| format!("ddn-scan-cpu-{i}"))
+            .build()
+            .expect("failed to build scan CPU pool");
+        ScanPools { io, cpu }
+    })
+}
+
+/// Runs a compute-heavy stage on the CPU pool, blocking the calling I/O
+/// worker until it finishes. In single-threaded mode the task runs inline
+/// so no pool threads are ever touched.
+fn run_cpu<R: Send>(config: &ScanConfig, task: impl FnOnce() -> R + Send) -> R {
+    if effective_concurrency_enabled(config) {
+        scan_pools().cpu.install(task)
+    } else {
+        task()
     }
 }
 
@@ -627,17 +1565,82 @@ fn effective_concurrency_enabled(config: &ScanConfig) -> bool {
     }
 }
 
-fn ffprobe_metadata(path: &Path) -> Option<String> {
-    let (tx, rx) = mpsc::channel();
-    let path = path.to_path_buf();
-    thread::spawn(move || {
-        let result = std::panic::catch_unwind(|| ffprobe_metadata_inner(&path))
-            .ok()
-            .flatten();
-        let _ = tx.send(result);
-    });
+/// Upper bound on resident ffprobe workers; probing is cheap per file, so a
+/// handful of processes keeps up with the hashing stages without letting a
+/// video-heavy directory fan out into hundreds of forks at once.
+const MAX_FFPROBE_WORKERS: usize = 8;
 
-    rx.recv_timeout(Duration::from_secs(30)).ok().flatten()
+/// Time budget for a single ffprobe invocation, enforced by the worker via
+/// `wait_timeout` so a wedged probe is killed rather than waited on.
+const FFPROBE_TIMEOUT: Duration = Duration::from_secs(30);
+
+struct FfprobeJob {
+    path: PathBuf,
+    reply: mpsc::Sender<Option<String>>,
+}
+
+/// Long-lived pool of ffprobe workers fed from a shared queue.
+///
+/// The old path spawned one watchdog thread per probed file, which on large
+/// media-heavy scans meant millions of short-lived threads bracketing the
+/// process forks. The pool keeps a fixed set of workers alive for the life
+/// of the process and bounds how many ffprobe processes run at once; the
+/// timeout is enforced per job inside the worker, so callers just block on
+/// their reply channel (every queued job ahead of them is itself bounded).
+struct FfprobePool {
+    jobs: Mutex<mpsc::Sender<FfprobeJob>>,
+}
+
+impl FfprobePool {
+    fn start() -> Self {
+        let (tx, rx) = mpsc::channel::<FfprobeJob>();
+        let rx = Arc::new(Mutex::new(rx));
+        let workers = thread::available_parallelism()
+            .map(|n| n.get())
+            .unwrap_or(4)
+            .min(MAX_FFPROBE_WORKERS);
+        for _ in 0..workers {
+            let rx = Arc::clone(&rx);
+            thread::spawn(move || loop {
+                let job = match rx.lock() {
+                    Ok(guard) => guard.recv(),
+                    Err(_) => break,
+                };
+                let Ok(job) = job else {
+                    break;
+                };
+                let result = std::panic::catch_unwind(|| ffprobe_metadata_inner(&job.path))
+                    .ok()
+                    .flatten();
+                let _ = job.reply.send(result);
+            });
+        }
+        Self {
+            jobs: Mutex::new(tx),
+        }
+    }
+
+    fn probe(&self, path: &Path) -> Option<String> {
+        let (reply_tx, reply_rx) = mpsc::channel();
+        let job = FfprobeJob {
+            path: path.to_path_buf(),
+            reply: reply_tx,
+        };
+        self.jobs.lock().ok()?.send(job).ok()?;
+        // A plain recv is safe here: the worker replies within the per-job
+        // timeout (None on kill or panic), and a dead worker drops the
+        // sender, which surfaces as RecvError.
+        reply_rx.recv().ok().flatten()
+    }
+}
+
+fn ffprobe_pool() -> &'static FfprobePool {
+    static POOL: OnceLock<FfprobePool> = OnceLock::new();
+    POOL.get_or_init(FfprobePool::start)
+}
+
+fn ffprobe_metadata(path: &Path) -> Option<String> {
+    ffprobe_pool().probe(path)
 }
 
 fn ffprobe_metadata_inner(path: &Path) -> Option<String> {
@@ -657,9 +1660,8 @@ fn ffprobe_metadata_inner(path: &Path) -> Option<String> {
 
     let mut stdout = child.stdout.take()?;
     let mut stderr = child.stderr.take()?;
-    let timeout = Duration::from_secs(30);
 
-    match child.wait_timeout(timeout).ok()? {
+    match child.wait_timeout(FFPROBE_TIMEOUT).ok()? {
         Some(status) => {
             let mut out = Vec::new();
             let mut err = Vec::new();
@@ -778,6 +1780,7 @@ fn video_snapshots_for_file(
     snapshots_per_video: u32,
     snapshot_max_dim: u32,
     timeout: Duration,
+    cpu_offload: bool,
 ) -> Option<Vec<FileSnapshotRecord>> {
     let duration_ms = duration_ms?;
     let (tx, rx) = mpsc::channel();
@@ -792,6 +1795,7 @@ fn video_snapshots_for_file(
                 snapshots_per_video,
                 snapshot_max_dim,
                 inner_timeout,
+                cpu_offload,
             )
         })
         .ok()
@@ -808,6 +1812,7 @@ fn video_snapshots_for_file_inner(
     snapshots_per_video: u32,
     snapshot_max_dim: u32,
     timeout: Duration,
+    cpu_offload: bool,
 ) -> Option<Vec<FileSnapshotRecord>> {
     if snapshots_per_video == 0 || duration_ms <= 0 {
         return Some(Vec::new());
@@ -816,13 +1821,8 @@ fn video_snapshots_for_file_inner(
     let deadline = Instant::now() + timeout;
     let duration_secs = (duration_ms as f64) / 1000.0;
 
-    let mut snaps = Vec::with_capacity(snapshots_per_video as usize);
+    let mut timestamps = Vec::with_capacity(snapshots_per_video as usize);
     for idx in 0..snapshots_per_video {
-        let remaining = deadline.saturating_duration_since(Instant::now());
-        if remaining < Duration::from_millis(250) {
-            break;
-        }
-
         let pos = ((idx + 1) as f64) / ((snapshots_per_video + 1) as f64);
         let mut at_secs = duration_secs * pos;
         if duration_secs > 2.0 {
@@ -830,21 +1830,45 @@ fn video_snapshots_for_file_inner(
         } else {
             at_secs = at_secs.clamp(0.0, duration_secs.max(0.0));
         }
+        timestamps.push(at_secs);
+    }
 
-        let per_snapshot_timeout = remaining.min(Duration::from_secs(10));
-        let image_avif =
-            match ffmpeg_snapshot_avif_inner(path, at_secs, snapshot_max_dim, per_snapshot_timeout)
-            {
-                Some(bytes) => bytes,
-                None => continue,
-            };
+    let frames = ffmpeg_snapshot_frames(path, &timestamps, snapshot_max_dim, timeout)?;
 
-        let (ahash, dhash, phash) = image_hashes_from_avif(&image_avif)
+    let mut snaps = Vec::with_capacity(frames.len());
+    for (idx, frame) in frames.iter().enumerate() {
+        if Instant::now() >= deadline {
+            break;
+        }
+        let at_secs = match timestamps.get(idx) {
+            Some(&v) => v,
+            None => break,
+        };
+
+        // The decoded frame is already in memory, so hash it directly
+        // instead of re-decoding the AVIF we are about to write. Hashing
+        // and the AVIF encode are pure compute, so they belong on the CPU
+        // pool rather than the thread minding the capture.
+        let compute = || {
+            let hashes = image_hashes_from_image(frame);
+            let avif = encode_snapshot_avif(frame);
+            (hashes, avif)
+        };
+        let (hashes, avif) = if cpu_offload {
+            scan_pools().cpu.install(compute)
+        } else {
+            compute()
+        };
+        let (ahash, dhash, phash) = hashes
             .map(|(a, d, p)| (Some(a), Some(d), Some(p)))
             .unwrap_or((None, None, None));
+        let image_avif = match avif {
+            Some(bytes) => bytes,
+            None => continue,
+        };
 
         snaps.push(FileSnapshotRecord {
-            snapshot_index: idx,
+            snapshot_index: idx as u32,
             snapshot_count: snapshots_per_video,
             at_ms: (at_secs * 1000.0).round() as i64,
             duration_ms: Some(duration_ms),
@@ -858,27 +1882,34 @@ fn video_snapshots_for_file_inner(
     Some(snaps)
 }
 
-fn ffmpeg_snapshot_avif_inner(
+/// Pulls every requested snapshot timestamp in a single ffmpeg invocation:
+/// one open, one demux/decode pass, frames streamed back as concatenated
+/// PNGs over stdout — no temp files and no per-snapshot re-seek of the
+/// input. A `select` expression picks the first frame at or past each
+/// timestamp; `-frames:v` stops the decode once the last one is out, so
+/// nothing beyond the final timestamp is read.
+///
+/// Frames arrive in timestamp order. On very short videos two adjacent
+/// timestamps can land on the same frame, in which case ffmpeg emits it
+/// once and the tail timestamps simply go without a frame.
+fn ffmpeg_snapshot_frames(
     path: &Path,
-    at_secs: f64,
+    timestamps: &[f64],
     snapshot_max_dim: u32,
     timeout: Duration,
-) -> Option<Vec<u8>> {
-    let ts = format!("{at_secs:.3}");
-    let mut out_path = std::env::temp_dir();
-    let unique = format!(
-        "dupdupninja-snapshot-{}-{}.avif",
-        std::process::id(),
-        SystemTime::now()
-            .duration_since(std::time::UNIX_EPOCH)
-            .ok()?
-            .as_nanos()
-    );
-    out_path.push(unique);
+) -> Option<Vec<image::DynamicImage>> {
+    if timestamps.is_empty() {
+        return Some(Vec::new());
+    }
 
     let max_dim = snapshot_max_dim.max(1);
-    let scale_filter = format!(
-        "scale='min(iw,{0})':'min(ih,{0})':force_original_aspect_ratio=decrease,scale=trunc(iw/2)*2:trunc(ih/2)*2",
+    let select_expr = timestamps
+        .iter()
+        .map(|t| format!("gte(t,{t:.3})*(isnan(prev_selected_t)+lt(prev_selected_t,{t:.3}))"))
+        .collect::<Vec<_>>()
+        .join("+");
+    let filter = format!(
+        "select='{select_expr}',scale='min(iw,{0})':'min(ih,{0})':force_original_aspect_ratio=decrease,scale=trunc(iw/2)*2:trunc(ih/2)*2",
         max_dim
     );
 
@@ -887,54 +1918,107 @@ fn ffmpeg_snapshot_avif_inner(
         .arg("-loglevel")
         .arg("error")
         .arg("-nostdin")
-        .arg("-ss")
-        .arg(ts)
         .arg("-i")
         .arg(path)
         .arg("-map")
         .arg("0:v:0")
-        .arg("-frames:v")
-        .arg("1")
         .arg("-an")
         .arg("-sn")
         .arg("-dn")
         .arg("-vf")
-        .arg(scale_filter)
-        .arg("-pix_fmt")
-        .arg("yuv420p")
+        .arg(filter)
+        .arg("-fps_mode")
+        .arg("vfr")
+        .arg("-frames:v")
+        .arg(timestamps.len().to_string())
+        .arg("-f")
+        .arg("image2pipe")
         .arg("-c:v")
-        .arg("libaom-av1")
-        .arg("-still-picture")
-        .arg("1")
-        .arg("-crf")
-        .arg("35")
-        .arg("-b:v")
-        .arg("0")
-        .stdout(Stdio::null())
+        .arg("png")
+        .arg("pipe:1")
+        .stdout(Stdio::piped())
         .stderr(Stdio::null())
-        .arg(&out_path)
         .spawn()
         .ok()?;
 
+    // Drain stdout on a helper thread: the PNG stream easily outgrows the
+    // pipe buffer, and a full pipe would deadlock the wait below. Killing
+    // the child on timeout closes the pipe and unblocks the reader.
+    let mut stdout = child.stdout.take()?;
+    let reader = thread::spawn(move || {
+        let mut buf = Vec::new();
+        stdout.read_to_end(&mut buf).ok().map(|_| buf)
+    });
+
     match child.wait_timeout(timeout).ok()? {
         Some(status) => {
-            if !status.success() {
-                let _ = std::fs::remove_file(&out_path);
+            let bytes = reader.join().ok().flatten()?;
+            if !status.success() || bytes.is_empty() {
                 return None;
             }
-            let bytes = std::fs::read(&out_path).ok()?;
-            let _ = std::fs::remove_file(&out_path);
-            Some(bytes)
+            let frames = split_png_stream(&bytes)
+                .into_iter()
+                .filter_map(|png| {
+                    image::load_from_memory_with_format(png, image::ImageFormat::Png).ok()
+                })
+                .collect();
+            Some(frames)
         }
         None => {
             let _ = child.kill();
             let _ = child.wait();
-            let _ = std::fs::remove_file(&out_path);
+            let _ = reader.join();
             None
         }
     }
 }
 
+/// Splits a stream of back-to-back PNG images by walking each image's chunk
+/// structure (8-byte signature, then length-prefixed chunks through IEND).
+/// Chunk walking is exact, unlike scanning for signature bytes, which can
+/// occur inside compressed image data. Trailing garbage or a truncated
+/// final image is dropped.
+fn split_png_stream(bytes: &[u8]) -> Vec<&[u8]> {
+    const PNG_SIG: [u8; 8] = [0x89, b'P', b'N', b'G', 0x0d, 0x0a, 0x1a, 0x0a];
+
+    let mut out = Vec::new();
+    let mut pos = 0usize;
+    'images: while bytes.len() - pos >= PNG_SIG.len() && bytes[pos..pos + 8] == PNG_SIG {
+        let start = pos;
+        pos += PNG_SIG.len();
+        loop {
+            if pos + 8 > bytes.len() {
+                break 'images;
+            }
+            let len = u32::from_be_bytes(bytes[pos..pos + 4].try_into().unwrap()) as usize;
+            let chunk_type = &bytes[pos + 4..pos + 8];
+            // length + type + data + crc
+            let Some(next) = pos.checked_add(12 + len) else {
+                break 'images;
+            };
+            if next > bytes.len() {
+                break 'images;
+            }
+            pos = next;
+            if chunk_type == b"IEND" {
+                break;
+            }
+        }
+        out.push(&bytes[start..pos]);
+    }
+    out
+}
+
+/// Encodes a snapshot frame to AVIF in-process via the image crate's rav1e
+/// backend. Speed 8 with mid quality lands close to the old
+/// `libaom-av1 -crf 35` output for thumbnail-sized stills.
+fn encode_snapshot_avif(frame: &image::DynamicImage) -> Option<Vec<u8>> {
+    let mut out = Vec::new();
+    let encoder = image::codecs::avif::AvifEncoder::new_with_speed_quality(&mut out, 8, 65);
+    frame.write_with_encoder(encoder).ok()?;
+    Some(out)
+}
+
 #[derive(Debug, Clone)]
 pub struct PrescanProgress {
     pub files_seen: u64,
@@ -1034,16 +2118,14 @@ fn is_image_file(path: &Path, file_type: Option<&str>) -> bool {
     )
 }
 
-fn image_hashes_from_path(path: &Path) -> Option<(u64, u64, u64)> {
+/// Decodes an image file and computes its perceptual hashes as
+/// `(ahash, dhash, phash)`; `None` when the file cannot be decoded.
+/// Public so the benchmark suite can measure it in isolation.
+pub fn image_hashes_from_path(path: &Path) -> Option<(u64, u64, u64)> {
     let image = image::open(path).ok()?;
     image_hashes_from_image(&image)
 }
 
-fn image_hashes_from_avif(bytes: &[u8]) -> Option<(u64, u64, u64)> {
-    let image = image::load_from_memory_with_format(bytes, image::ImageFormat::Avif).ok()?;
-    image_hashes_from_image(&image)
-}
-
 fn image_hashes_from_image(image: &image::DynamicImage) -> Option<(u64, u64, u64)> {
     let ahash = hash_image_with_alg(image, HashAlg::Mean, false)?;
     let dhash = hash_image_with_alg(image, HashAlg::Gradient, false)?;
@@ -0,0 +1,167 @@
+//! Near-neighbor lookup for 64-bit perceptual hashes.
+//!
+//! Pairwise comparison of ahash/dhash/phash values is O(n²) over a fileset,
+//! which stops being interactive somewhere around tens of thousands of
+//! images. A BK-tree over the Hamming metric answers "everything within
+//! distance d of this probe" by descending only the subtrees whose edge
+//! distances can still satisfy the triangle inequality, so threshold-8
+//! queries touch a small fraction of the tree.
+
+/// Hamming distance between two 64-bit perceptual hashes.
+pub fn hamming64(a: u64, b: u64) -> u32 {
+    (a ^ b).count_ones()
+}
+
+/// Scores one probe against a contiguous slice of candidate hashes,
+/// appending one distance per candidate to `out` (cleared first).
+///
+/// Callers gather a column of hashes into a plain `&[u64]` and score the
+/// whole batch in one call instead of walking row structs pair by pair. The
+/// fixed-width inner loop is written so the compiler vectorizes the
+/// xor + popcount across lanes (AVX2 on x86-64, NEON on aarch64), with the
+/// same code serving as the portable fallback.
+pub fn hamming_batch(probe: u64, candidates: &[u64], out: &mut Vec<u32>) {
+    const LANES: usize = 8;
+
+    out.clear();
+    out.reserve(candidates.len());
+    let mut chunks = candidates.chunks_exact(LANES);
+    for chunk in chunks.by_ref() {
+        let mut dist = [0u32; LANES];
+        for (d, &hash) in dist.iter_mut().zip(chunk) {
+            *d = (probe ^ hash).count_ones();
+        }
+        out.extend_from_slice(&dist);
+    }
+    for &hash in chunks.remainder() {
+        out.push((probe ^ hash).count_ones());
+    }
+}
+
+/// Mean best-match Hamming distance between two snapshot hash sequences.
+///
+/// Two captures of the same video rarely line up frame for frame: trims,
+/// intros, and re-encodes shift every timestamp. Instead of a positional
+/// diff, each hash of the shorter sequence is scored against the whole
+/// longer sequence via [`hamming_batch`] and contributes its closest match;
+/// the mean of those minima is the sequence distance. A trimmed copy still
+/// finds near-zero partners for every snapshot it kept, so the score stays
+/// low, while unrelated videos average out near the random-hash distance
+/// of 32. Returns `None` when either sequence is empty.
+pub fn snapshot_sequence_distance(a: &[u64], b: &[u64]) -> Option<f64> {
+    if a.is_empty() || b.is_empty() {
+        return None;
+    }
+    let (probe_seq, target_seq) = if a.len() <= b.len() { (a, b) } else { (b, a) };
+
+    let mut distances = Vec::with_capacity(target_seq.len());
+    let mut total = 0u64;
+    for &probe in probe_seq {
+        hamming_batch(probe, target_seq, &mut distances);
+        total += u64::from(
+            *distances
+                .iter()
+                .min()
+                .expect("target sequence is non-empty"),
+        );
+    }
+    Some(total as f64 / probe_seq.len() as f64)
+}
+
+struct BkNode {
+    hash: u64,
+    /// Caller-supplied ids of every row carrying exactly this hash value;
+    /// identical hashes are common (e.g. re-saved images) and collapse into
+    /// one node instead of a degenerate chain of distance-0 edges.
+    ids: Vec<u32>,
+    /// (edge distance, child node index). Nodes rarely have more than a
+    /// handful of children, so a flat list beats a 64-slot table.
+    children: Vec<(u8, u32)>,
+}
+
+/// BK-tree over 64-bit hashes keyed by Hamming distance.
+///
+/// Build once per hash kind with [`insert`](Self::insert), then run any
+/// number of [`query`](Self::query) probes against it. Nodes live in a single
+/// `Vec`, so the tree is cheap to build and cache-friendly to walk.
+#[derive(Default)]
+pub struct BkTree {
+    nodes: Vec<BkNode>,
+}
+
+impl BkTree {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.nodes.is_empty()
+    }
+
+    pub fn insert(&mut self, hash: u64, id: u32) {
+        if self.nodes.is_empty() {
+            self.nodes.push(BkNode {
+                hash,
+                ids: vec![id],
+                children: Vec::new(),
+            });
+            return;
+        }
+
+        let mut current = 0usize;
+        loop {
+            let dist = hamming64(hash, self.nodes[current].hash);
+            if dist == 0 {
+                self.nodes[current].ids.push(id);
+                return;
+            }
+            match self.nodes[current]
+                .children
+                .iter()
+                .find(|(edge, _)| *edge as u32 == dist)
+            {
+                Some(&(_, child)) => current = child as usize,
+                None => {
+                    let child = self.nodes.len() as u32;
+                    self.nodes.push(BkNode {
+                        hash,
+                        ids: vec![id],
+                        children: Vec::new(),
+                    });
+                    self.nodes[current].children.push((dist as u8, child));
+                    return;
+                }
+            }
+        }
+    }
+
+    /// Appends every `(id, distance)` within `max_distance` of `probe` to
+    /// `out`, in no particular order. The probe's own id is included if it
+    /// was inserted.
+    pub fn query(&self, probe: u64, max_distance: u32, out: &mut Vec<(u32, u32)>) {
+        if self.nodes.is_empty() {
+            return;
+        }
+
+        let mut stack = vec![0u32];
+        while let Some(node_idx) = stack.pop() {
+            let node = &self.nodes[node_idx as usize];
+            let dist = hamming64(probe, node.hash);
+            if dist <= max_distance {
+                out.extend(node.ids.iter().map(|&id| (id, dist)));
+            }
+
+            // Triangle inequality: a match at distance <= max from the probe
+            // sits at edge distance within [dist - max, dist + max] of this
+            // node, so every other subtree can be skipped wholesale.
+            let lo = dist.saturating_sub(max_distance);
+            let hi = dist + max_distance;
+            for &(edge, child) in &node.children {
+                let edge = edge as u32;
+                if edge >= lo && edge <= hi {
+                    stack.push(child);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,329 @@
+//! Shared decoded-thumbnail cache for the UI hosts.
+//!
+//! AVIF decode is slow enough that decoding a snapshot every time a row
+//! scrolls into view visibly hitches. This module keeps decoded RGBA
+//! thumbnails in an LRU cache keyed by `(file_id, snapshot_index,
+//! max_dim)` and decodes misses on background worker threads, so a list
+//! can `request` thumbnails around its viewport and pick them up with
+//! `get` once they are ready. Completion is signalled through a
+//! monotonically increasing sequence number (`ready_seq`, same polling
+//! idiom as the scan progress board) rather than callbacks, which keeps
+//! the API usable from the GTK main loop and over the FFI alike.
+
+use std::collections::{HashMap, HashSet, VecDeque};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, Condvar, Mutex};
+use std::thread::{self, JoinHandle};
+
+use crate::db::SqliteScanStore;
+use crate::error::Result;
+
+/// Background decode threads per cache. Decode is CPU-bound and a list
+/// only ever needs a screenful of thumbnails ahead of the viewport, so
+/// two workers keep up without competing with the scan pools.
+const THUMBNAIL_WORKERS: usize = 2;
+
+/// Pending requests beyond this are dropped oldest-first; if the
+/// viewport has moved past them nobody will look at the result anyway.
+const MAX_QUEUED_REQUESTS: usize = 1024;
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
+pub struct ThumbnailKey {
+    pub file_id: i64,
+    pub snapshot_index: u32,
+    /// Longest output edge in pixels; decode scales down preserving
+    /// aspect ratio and never scales up.
+    pub max_dim: u32,
+}
+
+#[derive(Clone, Debug)]
+pub struct Thumbnail {
+    pub width: u32,
+    pub height: u32,
+    /// Tightly packed RGBA8 pixels, `width * height * 4` bytes. Shared,
+    /// so a cache hit hands out a pointer copy, not a pixel copy.
+    pub rgba: Arc<[u8]>,
+}
+
+struct CacheEntry {
+    thumb: Thumbnail,
+    last_used: u64,
+}
+
+#[derive(Default)]
+struct CacheState {
+    entries: HashMap<ThumbnailKey, CacheEntry>,
+    bytes: usize,
+    tick: u64,
+    queue: VecDeque<ThumbnailKey>,
+    in_flight: HashSet<ThumbnailKey>,
+    /// Keys whose snapshot is missing or undecodable; remembered so the
+    /// UI asking every frame does not retry the decode every frame.
+    failed: HashSet<ThumbnailKey>,
+}
+
+struct CacheShared {
+    db_path: PathBuf,
+    capacity_bytes: usize,
+    state: Mutex<CacheState>,
+    /// Store for inline decodes on the caller's thread, opened lazily;
+    /// the workers each hold their own connection.
+    foreground: Mutex<Option<SqliteScanStore>>,
+    work_ready: Condvar,
+    decode_done: Condvar,
+    ready_seq: AtomicU64,
+    shutdown: AtomicBool,
+}
+
+pub struct ThumbnailCache {
+    shared: Arc<CacheShared>,
+    workers: Vec<JoinHandle<()>>,
+}
+
+impl ThumbnailCache {
+    /// Opens a cache over one fileset database with a pixel-data budget
+    /// in bytes, and starts the background decode workers. The database
+    /// is opened once up front so a bad path fails here, not silently in
+    /// a worker.
+    pub fn open(db_path: &Path, capacity_bytes: usize) -> Result<Self> {
+        drop(SqliteScanStore::open(db_path)?);
+        let shared = Arc::new(CacheShared {
+            db_path: db_path.to_path_buf(),
+            capacity_bytes: capacity_bytes.max(1),
+            state: Mutex::new(CacheState::default()),
+            foreground: Mutex::new(None),
+            work_ready: Condvar::new(),
+            decode_done: Condvar::new(),
+            ready_seq: AtomicU64::new(0),
+            shutdown: AtomicBool::new(false),
+        });
+        let workers = (0..THUMBNAIL_WORKERS)
+            .map(|i| {
+                let shared = Arc::clone(&shared);
+                thread::Builder::new()
+                    .name(format!("ddn-thumb-{i}"))
+                    .spawn(move || worker_loop(shared))
+                    .expect("failed to spawn thumbnail worker")
+            })
+            .collect();
+        Ok(Self { shared, workers })
+    }
+
+    /// Cache-only lookup; never blocks and never decodes. A hit bumps
+    /// the entry's recency.
+    pub fn get(&self, key: ThumbnailKey) -> Option<Thumbnail> {
+        let mut state = self.shared.state.lock().unwrap();
+        state.tick += 1;
+        let tick = state.tick;
+        let entry = state.entries.get_mut(&key)?;
+        entry.last_used = tick;
+        Some(entry.thumb.clone())
+    }
+
+    /// Queues a background decode for `key` unless it is already cached,
+    /// in flight, or known to fail. Returns immediately; watch
+    /// [`ThumbnailCache::ready_seq`] to learn when results land.
+    pub fn request(&self, key: ThumbnailKey) {
+        let mut state = self.shared.state.lock().unwrap();
+        if state.entries.contains_key(&key)
+            || state.in_flight.contains(&key)
+            || state.failed.contains(&key)
+        {
+            return;
+        }
+        while state.queue.len() >= MAX_QUEUED_REQUESTS {
+            state.queue.pop_front();
+        }
+        state.queue.push_back(key);
+        drop(state);
+        self.shared.work_ready.notify_one();
+    }
+
+    /// Queues decodes for every key, typically the rows around the
+    /// viewport plus a margin, newest last so workers serve the most
+    /// recently requested keys first.
+    pub fn prefetch<I: IntoIterator<Item = ThumbnailKey>>(&self, keys: I) {
+        for key in keys {
+            self.request(key);
+        }
+    }
+
+    /// Blocking lookup: returns the cached thumbnail, waits for an
+    /// in-flight decode, or decodes inline on the calling thread.
+    /// `Ok(None)` means the snapshot does not exist or cannot be
+    /// decoded.
+    pub fn get_or_decode(&self, key: ThumbnailKey) -> Result<Option<Thumbnail>> {
+        {
+            let mut state = self.shared.state.lock().unwrap();
+            loop {
+                if state.failed.contains(&key) {
+                    return Ok(None);
+                }
+                state.tick += 1;
+                let tick = state.tick;
+                if let Some(entry) = state.entries.get_mut(&key) {
+                    entry.last_used = tick;
+                    return Ok(Some(entry.thumb.clone()));
+                }
+                if state.in_flight.contains(&key) {
+                    state = self.shared.decode_done.wait(state).unwrap();
+                    continue;
+                }
+                state.in_flight.insert(key);
+                break;
+            }
+        }
+
+        let decoded = {
+            let mut foreground = self.shared.foreground.lock().unwrap();
+            if foreground.is_none() {
+                match SqliteScanStore::open(&self.shared.db_path) {
+                    Ok(store) => *foreground = Some(store),
+                    Err(err) => {
+                        // Unclaim the key so a later call can retry; an
+                        // open failure is not a property of this key.
+                        let mut state = self.shared.state.lock().unwrap();
+                        state.in_flight.remove(&key);
+                        drop(state);
+                        self.shared.decode_done.notify_all();
+                        return Err(err);
+                    }
+                }
+            }
+            decode_thumbnail(foreground.as_ref().unwrap(), key)
+        };
+        let thumb = decoded.clone();
+        finish_decode(&self.shared, key, decoded);
+        Ok(thumb)
+    }
+
+    /// Increases every time a background decode finishes (successfully
+    /// or not). Pollers redraw when it changed and skip work when it did
+    /// not, like the scan progress board's seq.
+    pub fn ready_seq(&self) -> u64 {
+        self.shared.ready_seq.load(Ordering::Acquire)
+    }
+}
+
+impl Drop for ThumbnailCache {
+    fn drop(&mut self) {
+        self.shared.shutdown.store(true, Ordering::Release);
+        self.shared.work_ready.notify_all();
+        for worker in self.workers.drain(..) {
+            let _ = worker.join();
+        }
+    }
+}
+
+fn worker_loop(shared: Arc<CacheShared>) {
+    // The open succeeded in ThumbnailCache::open; if it fails now the
+    // worker retires and inline decodes still work.
+    let Ok(store) = SqliteScanStore::open(&shared.db_path) else {
+        return;
+    };
+    loop {
+        let key = {
+            let mut state = shared.state.lock().unwrap();
+            loop {
+                if shared.shutdown.load(Ordering::Acquire) {
+                    return;
+                }
+                // Newest requests first: they are the ones nearest the
+                // viewport right now.
+                match state.queue.pop_back() {
+                    Some(key)
+                        if !state.entries.contains_key(&key)
+                            && !state.in_flight.contains(&key)
+                            && !state.failed.contains(&key) =>
+                    {
+                        state.in_flight.insert(key);
+                        break key;
+                    }
+                    Some(_) => continue,
+                    None => state = shared.work_ready.wait(state).unwrap(),
+                }
+            }
+        };
+        let decoded = decode_thumbnail(&store, key);
+        finish_decode(&shared, key, decoded);
+    }
+}
+
+fn finish_decode(shared: &CacheShared, key: ThumbnailKey, decoded: Option<Thumbnail>) {
+    {
+        let mut state = shared.state.lock().unwrap();
+        state.in_flight.remove(&key);
+        match decoded {
+            Some(thumb) => insert_entry(&mut state, shared.capacity_bytes, key, thumb),
+            None => {
+                state.failed.insert(key);
+            }
+        }
+    }
+    shared.ready_seq.fetch_add(1, Ordering::Release);
+    shared.decode_done.notify_all();
+}
+
+fn insert_entry(
+    state: &mut CacheState,
+    capacity_bytes: usize,
+    key: ThumbnailKey,
+    thumb: Thumbnail,
+) {
+    state.tick += 1;
+    let tick = state.tick;
+    state.bytes += entry_cost(&thumb);
+    state.entries.insert(
+        key,
+        CacheEntry {
+            thumb,
+            last_used: tick,
+        },
+    );
+    // Evict least-recently-used entries until back under budget. The
+    // linear scan is fine at the few hundred entries a screenful of
+    // thumbnails amounts to.
+    while state.bytes > capacity_bytes && state.entries.len() > 1 {
+        let Some(oldest) = state
+            .entries
+            .iter()
+            .min_by_key(|(_, entry)| entry.last_used)
+            .map(|(key, _)| *key)
+        else {
+            break;
+        };
+        if let Some(entry) = state.entries.remove(&oldest) {
+            state.bytes = state.bytes.saturating_sub(entry_cost(&entry.thumb));
+        }
+    }
+}
+
+fn entry_cost(thumb: &Thumbnail) -> usize {
+    thumb.rgba.len() + std::mem::size_of::<CacheEntry>()
+}
+
+/// Reads the snapshot blob through SQLite's incremental blob I/O,
+/// decodes it, and scales to the requested edge. `None` for a missing
+/// snapshot or a blob the image decoder rejects.
+fn decode_thumbnail(store: &SqliteScanStore, key: ThumbnailKey) -> Option<Thumbnail> {
+    let (rowid, len) = store
+        .locate_snapshot_blob(key.file_id, key.snapshot_index)
+        .ok()??;
+    let mut buf = vec![0u8; len as usize];
+    let read = store.read_snapshot_blob_at(rowid, 0, &mut buf).ok()?;
+    buf.truncate(read);
+    let image = image::load_from_memory(&buf).ok()?;
+    let scaled = if image.width() > key.max_dim || image.height() > key.max_dim {
+        image.thumbnail(key.max_dim, key.max_dim)
+    } else {
+        image
+    };
+    let rgba = scaled.to_rgba8();
+    let (width, height) = rgba.dimensions();
+    Some(Thumbnail {
+        width,
+        height,
+        rgba: rgba.into_raw().into(),
+    })
+}
@@ -11,13 +11,29 @@ extern "C" {
 
 typedef struct DupdupEngine DupdupEngine;
 typedef struct DupdupCancelToken DupdupCancelToken;
+typedef struct DupdupRowCursor DupdupRowCursor;
+typedef struct DupdupRowArena DupdupRowArena;
+typedef struct DupdupSnapshotBlob DupdupSnapshotBlob;
+typedef struct DupdupThumbnailCache DupdupThumbnailCache;
+typedef struct DupdupProgressBoard DupdupProgressBoard;
 
 enum {
   DUPDUPNINJA_FFI_ABI_MAJOR = 1,
-  DUPDUPNINJA_FFI_ABI_MINOR = 3,
+  DUPDUPNINJA_FFI_ABI_MINOR = 12,
   DUPDUPNINJA_FFI_ABI_PATCH = 0,
 };
 
+enum {
+  DUPDUPNINJA_BOARD_TASK_SLOTS = 32,
+  DUPDUPNINJA_BOARD_PATH_MAX = 512,
+  DUPDUPNINJA_BOARD_STEP_MAX = 32,
+};
+
+enum {
+  DUPDUPNINJA_STAGE_NAME_MAX = 32,
+  DUPDUPNINJA_STAGE_BUCKETS = 24,
+};
+
 typedef struct DupdupNinjaVersion {
   uint32_t major;
   uint32_t minor;
@@ -31,6 +47,16 @@ typedef enum DupdupStatus {
   DUPDUP_STATUS_NULL_POINTER = 3,
 } DupdupStatus;
 
+// Lifecycle of a scan job submitted through
+// dupdupninja_engine_submit_scan.
+typedef enum DupdupJobState {
+  DUPDUP_JOB_QUEUED = 0,
+  DUPDUP_JOB_RUNNING = 1,
+  DUPDUP_JOB_COMPLETED = 2,
+  DUPDUP_JOB_FAILED = 3,
+  DUPDUP_JOB_CANCELLED = 4,
+} DupdupJobState;
+
 typedef struct DupdupProgress {
   uint64_t files_seen;
   uint64_t files_hashed;
@@ -127,8 +153,57 @@ DupdupNinjaVersion dupdupninja_ffi_version(void);
 uint32_t dupdupninja_ffi_abi_major(void);
 
 DupdupEngine* dupdupninja_engine_new(void);
+
+// Frees the engine. Jobs still queued are cancelled; jobs already
+// running finish first, so this blocks until every submitted scan has
+// retired.
 void dupdupninja_engine_free(DupdupEngine* engine);
 
+// Adjusts the engine's shared resource budget: how many scan jobs may
+// run at once overall and how many may run against the same drive.
+// Defaults are 4 and 1. A zero leaves the current value unchanged.
+DupdupStatus dupdupninja_engine_configure(
+  DupdupEngine* engine,
+  uint32_t max_active_jobs,
+  uint32_t max_jobs_per_drive
+);
+
+// Submits a scan job (root + database + options) and returns
+// immediately with its job id in out_job_id. Jobs share the engine's
+// budgets and the process-wide I/O/CPU pools; jobs on the same drive
+// start in submission order. options may be NULL for defaults and
+// cancel_token may be NULL. The progress callback fires on the job's
+// worker thread, so user_data must be safe to touch from there; pass a
+// distinct user_data per job to tell the streams apart.
+DupdupStatus dupdupninja_engine_submit_scan(
+  DupdupEngine* engine,
+  const char* root_path,
+  const char* db_path,
+  const DupdupScanOptions* options,
+  DupdupCancelToken* cancel_token,
+  DupdupProgressCallback progress_cb,
+  void* user_data,
+  uint64_t* out_job_id
+);
+
+// Writes the current state of one submitted job to out_state. Fails
+// with DUPDUP_STATUS_INVALID_ARGUMENT for an unknown job id.
+DupdupStatus dupdupninja_engine_job_state(
+  DupdupEngine* engine,
+  uint64_t job_id,
+  DupdupJobState* out_state
+);
+
+// Blocks until one job retires. DUPDUP_STATUS_OK for a completed job; a
+// failed or cancelled job returns DUPDUP_STATUS_ERROR with the reason
+// in the last error message, matching the blocking scan calls.
+DupdupStatus dupdupninja_engine_wait_job(DupdupEngine* engine, uint64_t job_id);
+
+// Blocks until every submitted job has retired. DUPDUP_STATUS_OK when
+// all completed; otherwise DUPDUP_STATUS_ERROR with a summary in the
+// last error message — query individual jobs for details.
+DupdupStatus dupdupninja_engine_wait_all(DupdupEngine* engine);
+
 DupdupCancelToken* dupdupninja_cancel_token_new(void);
 void dupdupninja_cancel_token_free(DupdupCancelToken* token);
 void dupdupninja_cancel_token_cancel(DupdupCancelToken* token);
@@ -185,6 +260,56 @@ DupdupStatus dupdupninja_scan_folder_to_sqlite_with_progress_totals_and_options(
   void* user_data
 );
 
+typedef struct DupdupBoardTask {
+  char path[DUPDUPNINJA_BOARD_PATH_MAX];
+  char step[DUPDUPNINJA_BOARD_STEP_MAX];
+} DupdupBoardTask;
+
+// Caller-owned copy of the progress board: plain counters plus a fixed
+// table of in-flight tasks, with no pointers to free. seq increases on
+// every board update, so a host can skip redraws when it is unchanged.
+typedef struct DupdupProgressSnapshot {
+  uint64_t seq;
+  uint64_t files_seen;
+  uint64_t files_hashed;
+  uint64_t files_skipped;
+  uint64_t bytes_seen;
+  uint64_t total_files;
+  uint64_t total_bytes;
+  uintptr_t active_len;
+  DupdupBoardTask active[DUPDUPNINJA_BOARD_TASK_SLOTS];
+} DupdupProgressSnapshot;
+
+// Creates a progress board for dupdupninja_scan_folder_to_sqlite_with_board.
+// Safe to read from any thread while a scan publishes into it; keep it
+// alive until the scan returns, then release with
+// dupdupninja_progress_board_free.
+DupdupProgressBoard* dupdupninja_progress_board_new(void);
+void dupdupninja_progress_board_free(DupdupProgressBoard* board);
+
+// Copies the board into out. Paths and steps longer than the fixed buffers
+// are truncated; nothing is allocated and nothing needs freeing.
+DupdupStatus dupdupninja_progress_board_read(
+  const DupdupProgressBoard* board,
+  DupdupProgressSnapshot* out
+);
+
+// Like dupdupninja_scan_folder_to_sqlite_with_progress_totals_and_options
+// but publishes progress into a shared board instead of invoking a
+// callback per event; poll with dupdupninja_progress_board_read at your
+// own frame rate. Pass total_files = total_bytes = 0 to let the walker
+// discover totals as it goes.
+DupdupStatus dupdupninja_scan_folder_to_sqlite_with_board(
+  DupdupEngine* engine,
+  const char* root_path,
+  const char* db_path,
+  DupdupCancelToken* cancel_token,
+  uint64_t total_files,
+  uint64_t total_bytes,
+  const DupdupScanOptions* options,
+  DupdupProgressBoard* board
+);
+
 DupdupStatus dupdupninja_fileset_list_rows(
   const char* db_path,
   uint8_t duplicates_only,
@@ -194,6 +319,52 @@ DupdupStatus dupdupninja_fileset_list_rows(
   uintptr_t* out_len
 );
 
+// Row view whose strings point into the arena that returned it; valid
+// until the arena is freed. Mirrors DupdupFilesetRow field for field.
+typedef struct DupdupFilesetRowView {
+  int64_t id;
+  const char* path;
+  uint64_t size_bytes;
+  const char* file_type;
+  const char* blake3_hex;
+  const char* sha256_hex;
+} DupdupFilesetRowView;
+
+// Arena-backed variant of dupdupninja_fileset_list_rows: the whole result
+// set lives in two allocations instead of several CString mallocs per row,
+// and dupdupninja_fileset_rows_arena_free releases everything in one call.
+DupdupStatus dupdupninja_fileset_list_rows_arena(
+  const char* db_path,
+  uint8_t duplicates_only,
+  uint64_t limit,
+  uint64_t offset,
+  DupdupRowArena** out_arena,
+  const DupdupFilesetRowView** out_rows,
+  uintptr_t* out_len
+);
+
+void dupdupninja_fileset_rows_arena_free(DupdupRowArena* arena);
+
+// Paged cursor over a fileset's rows in path order. Unlike
+// dupdupninja_fileset_list_rows nothing is materialized up front: each
+// _next call fetches one page of at most page_size rows (freed with
+// dupdupninja_fileset_rows_free); an empty page means the cursor is
+// exhausted.
+DupdupStatus dupdupninja_fileset_rows_cursor_open(
+  const char* db_path,
+  uint8_t duplicates_only,
+  DupdupRowCursor** out_cursor
+);
+
+DupdupStatus dupdupninja_fileset_rows_cursor_next(
+  DupdupRowCursor* cursor,
+  uint64_t page_size,
+  DupdupFilesetRow** out_rows,
+  uintptr_t* out_len
+);
+
+void dupdupninja_fileset_rows_cursor_free(DupdupRowCursor* cursor);
+
 DupdupStatus dupdupninja_fileset_list_similar_groups(
   const char* db_path,
   uint64_t limit,
@@ -207,6 +378,18 @@ DupdupStatus dupdupninja_fileset_list_similar_groups(
   uintptr_t* out_rows_len
 );
 
+// Video-to-video similar groups over snapshot phash sequences. phash_distance
+// on each row is the rounded mean sequence distance to the group's first row;
+// dhash/ahash distances do not apply to videos and are reported as 64.
+DupdupStatus dupdupninja_fileset_list_video_similar_groups(
+  const char* db_path,
+  uint8_t phash_max_distance,
+  DupdupSimilarGroup** out_groups,
+  uintptr_t* out_groups_len,
+  DupdupSimilarRow** out_rows,
+  uintptr_t* out_rows_len
+);
+
 void dupdupninja_fileset_rows_free(DupdupFilesetRow* rows, uintptr_t len);
 void dupdupninja_similar_rows_free(DupdupSimilarRow* rows, uintptr_t len);
 
@@ -252,6 +435,144 @@ DupdupStatus dupdupninja_fileset_list_snapshots_by_path(
 
 void dupdupninja_snapshots_info_free(DupdupSnapshotInfo* rows, uintptr_t len);
 
+typedef struct DupdupCompareRow {
+  char* path;
+  uint64_t size_bytes;
+  char* file_type;
+  // Non-zero when a row with different bytes but an identical phash
+  // exists on the other side.
+  uint8_t phash_match;
+} DupdupCompareRow;
+
+typedef struct DupdupCompareSummary {
+  char* self_label;
+  char* other_label;
+  uint64_t matched_files;
+  uint64_t self_unhashed;
+  uint64_t other_unhashed;
+} DupdupCompareSummary;
+
+// Compares two scan databases by content hash; the other database is
+// attached inside SQLite so the diff never round-trips rows through the
+// host. out_self_rows receives files only in db_path, out_other_rows
+// files only in other_db_path. Free the row arrays with
+// dupdupninja_compare_rows_free and the summary's strings with
+// dupdupninja_compare_summary_free.
+DupdupStatus dupdupninja_fileset_compare(
+  const char* db_path,
+  const char* other_db_path,
+  DupdupCompareSummary* out_summary,
+  DupdupCompareRow** out_self_rows,
+  uintptr_t* out_self_len,
+  DupdupCompareRow** out_other_rows,
+  uintptr_t* out_other_len
+);
+
+void dupdupninja_compare_rows_free(DupdupCompareRow* rows, uintptr_t len);
+void dupdupninja_compare_summary_free(DupdupCompareSummary* summary);
+
+// Per-stage timing profile of a completed scan. buckets[i] counts calls
+// that took [2^i, 2^(i+1)) microseconds; the last bucket absorbs
+// everything slower.
+typedef struct DupdupStageTiming {
+  char stage[DUPDUPNINJA_STAGE_NAME_MAX];
+  uint64_t calls;
+  uint64_t total_micros;
+  uint64_t buckets[DUPDUPNINJA_STAGE_BUCKETS];
+} DupdupStageTiming;
+
+// Copies the stage timing profile recorded by the most recent successful
+// scan call on this thread into out_timings; *out_len receives how many
+// entries were written (at most capacity). Stages that never ran report
+// zero calls. Per-thread state like dupdupninja_last_error_message: call
+// from the thread that ran the scan.
+DupdupStatus dupdupninja_scan_stage_timings(
+  DupdupStageTiming* out_timings,
+  uintptr_t capacity,
+  uintptr_t* out_len
+);
+
+// Opens a read handle to one snapshot's AVIF blob. Unlike
+// dupdupninja_fileset_list_snapshots_by_path nothing is copied at open
+// time: reads go through SQLite's incremental blob I/O straight into the
+// caller's buffer. Writes the blob's total byte length to out_len. Fails
+// with DUPDUP_STATUS_INVALID_ARGUMENT when the file or snapshot does not
+// exist. Close with dupdupninja_snapshot_blob_free.
+DupdupStatus dupdupninja_snapshot_blob_open(
+  const char* db_path,
+  const char* file_path,
+  uint32_t snapshot_index,
+  DupdupSnapshotBlob** out_blob,
+  uint64_t* out_len
+);
+
+// Reads up to buf_len bytes of the blob starting at offset into buf.
+// Writes the number of bytes read to out_read — short only at the end of
+// the blob, zero at or past it.
+DupdupStatus dupdupninja_snapshot_blob_read(
+  DupdupSnapshotBlob* blob,
+  uint64_t offset,
+  uint8_t* buf,
+  uintptr_t buf_len,
+  uintptr_t* out_read
+);
+
+void dupdupninja_snapshot_blob_free(DupdupSnapshotBlob* blob);
+
+// Opens a decoded-thumbnail cache over one fileset database with a
+// pixel-data budget of capacity_bytes, and starts its background decode
+// workers. Hosts keep one cache per list/database and share it across
+// rows. Close with dupdupninja_thumbnail_cache_free.
+DupdupStatus dupdupninja_thumbnail_cache_new(
+  const char* db_path,
+  uint64_t capacity_bytes,
+  DupdupThumbnailCache** out_cache
+);
+
+void dupdupninja_thumbnail_cache_free(DupdupThumbnailCache* cache);
+
+// Queues a background decode for one thumbnail; returns immediately.
+// Call this for the rows around the viewport as the user scrolls, then
+// poll dupdupninja_thumbnail_cache_ready_seq to learn when results are
+// worth re-fetching. max_dim is the longest output edge in pixels.
+DupdupStatus dupdupninja_thumbnail_cache_request(
+  DupdupThumbnailCache* cache,
+  int64_t file_id,
+  uint32_t snapshot_index,
+  uint32_t max_dim
+);
+
+// Writes the cache's completion counter to out_seq. It increases every
+// time a background decode finishes, so a host polls it and only
+// re-fetches thumbnails when the value changed.
+DupdupStatus dupdupninja_thumbnail_cache_ready_seq(
+  DupdupThumbnailCache* cache,
+  uint64_t* out_seq
+);
+
+// Fetches one decoded thumbnail as tightly packed RGBA8. On a hit the
+// pixels are copied into a library-owned buffer the caller frees with
+// dupdupninja_thumbnail_rgba_free. On a miss with decode_if_missing 0
+// the call queues a background decode and returns DUPDUP_STATUS_OK with
+// *out_rgba NULL — poll the ready seq and retry; with it nonzero the
+// call blocks and decodes on this thread. A NULL *out_rgba after a
+// blocking call means the snapshot does not exist or cannot be decoded.
+DupdupStatus dupdupninja_thumbnail_cache_get(
+  DupdupThumbnailCache* cache,
+  int64_t file_id,
+  uint32_t snapshot_index,
+  uint32_t max_dim,
+  uint8_t decode_if_missing,
+  uint32_t* out_width,
+  uint32_t* out_height,
+  uint8_t** out_rgba,
+  uintptr_t* out_len
+);
+
+// Frees a pixel buffer returned by dupdupninja_thumbnail_cache_get. len
+// must be the length the get call reported.
+void dupdupninja_thumbnail_rgba_free(uint8_t* rgba, uintptr_t len);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -1,21 +1,34 @@
 #![allow(unsafe_code)]
 
 use std::cell::RefCell;
-use std::collections::BTreeMap;
+use std::collections::HashMap;
 use std::ffi::{CStr, CString};
 use std::os::raw::c_char;
-use std::path::PathBuf;
+use std::path::{Path, PathBuf};
 use std::slice;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Condvar, Mutex};
+use std::thread::{self, JoinHandle};
 
 use dupdupninja_core::db::SqliteScanStore;
-use dupdupninja_core::models::{DriveMetadata, FilesetMetadata, ScanRootKind};
+use dupdupninja_core::models::{
+    DriveMetadata, FilesetMetadata, ScanRootKind, StageTiming, SCAN_STAGE_BUCKETS,
+};
 use dupdupninja_core::scan::{
     prescan, scan_to_sqlite, scan_to_sqlite_with_progress, scan_to_sqlite_with_progress_and_totals,
-    PrescanProgress, ScanCancelToken, ScanConfig, ScanTotals,
+    scan_to_sqlite_with_progress_totals_and_board, PrescanProgress, ScanCancelToken, ScanConfig,
+    ScanProgressBoard, ScanTotals, PROGRESS_BOARD_TASK_SLOTS,
 };
+use dupdupninja_core::similar::{hamming64, hamming_batch, snapshot_sequence_distance, BkTree};
+use dupdupninja_core::thumbs::{Thumbnail, ThumbnailCache, ThumbnailKey};
+use dupdupninja_core::Error as CoreError;
 
 thread_local! {
     static LAST_ERROR: RefCell<Option<CString>> = const { RefCell::new(None) };
+    // Stage timings of the most recent completed scan on this thread,
+    // mirroring the LAST_ERROR convention: read them from the thread
+    // that ran the scan call.
+    static LAST_STAGE_TIMINGS: RefCell<Vec<StageTiming>> = const { RefCell::new(Vec::new()) };
 }
 
 fn set_last_error(msg: impl Into<String>) {
@@ -32,12 +45,111 @@ fn ok_last_error() {
     });
 }
 
+fn remember_stage_timings(timings: &[StageTiming]) {
+    LAST_STAGE_TIMINGS.with(|slot| {
+        *slot.borrow_mut() = timings.to_vec();
+    });
+}
+
 #[repr(C)]
 pub struct DupdupEngine {
     _private: [u8; 0],
 }
 
-struct Engine;
+/// Default cap on scan jobs running at once. The core's I/O and CPU
+/// pools are process-wide, so this bounds how many roots contend for
+/// them, not the thread count.
+const DEFAULT_MAX_ACTIVE_JOBS: u32 = 4;
+
+/// Default cap on concurrently running jobs whose roots resolve to the
+/// same drive. One at a time keeps each drive's reads sequential, which
+/// is what spinning disks and most NAS shares want.
+const DEFAULT_MAX_JOBS_PER_DRIVE: u32 = 1;
+
+struct JobRecord {
+    state: DupdupJobState,
+    error: Option<String>,
+    drive_key: String,
+    /// Submission order; queued jobs on the same drive start in this
+    /// order.
+    seq: u64,
+}
+
+struct SchedulerState {
+    jobs: HashMap<u64, JobRecord>,
+    running_total: u32,
+    running_per_drive: HashMap<String, u32>,
+    max_active_jobs: u32,
+    max_jobs_per_drive: u32,
+    shutdown: bool,
+}
+
+struct Scheduler {
+    state: Mutex<SchedulerState>,
+    /// Signalled when a running job releases its slot or the limits are
+    /// raised.
+    slot_free: Condvar,
+    /// Signalled whenever a job reaches a terminal state.
+    job_done: Condvar,
+}
+
+/// The engine: a scheduler for submitted scan jobs. Each job gets its
+/// own thread, but the threads gate on the shared budgets before
+/// touching the disk, so submitting six drives does not mean six scans
+/// hammering the array at once.
+struct Engine {
+    scheduler: Arc<Scheduler>,
+    next_job_id: AtomicU64,
+    workers: Mutex<Vec<JoinHandle<()>>>,
+}
+
+impl Engine {
+    fn new() -> Self {
+        Self {
+            scheduler: Arc::new(Scheduler {
+                state: Mutex::new(SchedulerState {
+                    jobs: HashMap::new(),
+                    running_total: 0,
+                    running_per_drive: HashMap::new(),
+                    max_active_jobs: DEFAULT_MAX_ACTIVE_JOBS,
+                    max_jobs_per_drive: DEFAULT_MAX_JOBS_PER_DRIVE,
+                    shutdown: false,
+                }),
+                slot_free: Condvar::new(),
+                job_done: Condvar::new(),
+            }),
+            next_job_id: AtomicU64::new(0),
+            workers: Mutex::new(Vec::new()),
+        }
+    }
+}
+
+impl Drop for Engine {
+    fn drop(&mut self) {
+        {
+            let mut state = self.scheduler.state.lock().unwrap();
+            state.shutdown = true;
+        }
+        // Queued jobs wake up, see the shutdown, and retire as
+        // Cancelled; running jobs finish normally and are joined.
+        self.scheduler.slot_free.notify_all();
+        let workers = std::mem::take(&mut *self.workers.lock().unwrap());
+        for worker in workers {
+            let _ = worker.join();
+        }
+    }
+}
+
+/// A host progress callback plus its user_data, handed to an engine
+/// worker thread. The C contract already requires the pair to be
+/// callable from whichever thread runs the scan; `Send` just states
+/// that to the compiler.
+struct JobCallback {
+    progress_cb: DupdupProgressCallback,
+    user_data: *mut libc::c_void,
+}
+
+unsafe impl Send for JobCallback {}
 
 #[repr(C)]
 pub struct DupdupCancelToken {
@@ -147,7 +259,7 @@ pub struct DupdupSnapshotInfo {
 }
 
 const FFI_ABI_MAJOR: u32 = 1;
-const FFI_ABI_MINOR: u32 = 3;
+const FFI_ABI_MINOR: u32 = 12;
 const FFI_ABI_PATCH: u32 = 0;
 
 #[repr(C)]
@@ -167,10 +279,22 @@ pub enum DupdupStatus {
     NullPointer = 3,
 }
 
+/// Lifecycle of a scan job submitted through
+/// [`dupdupninja_engine_submit_scan`].
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum DupdupJobState {
+    Queued = 0,
+    Running = 1,
+    Completed = 2,
+    Failed = 3,
+    Cancelled = 4,
+}
+
 #[no_mangle]
 pub extern "C" fn dupdupninja_engine_new() -> *mut DupdupEngine {
     ok_last_error();
-    let engine = Box::new(Engine);
+    let engine = Box::new(Engine::new());
     Box::into_raw(engine) as *mut DupdupEngine
 }
 
@@ -188,6 +312,9 @@ pub extern "C" fn dupdupninja_ffi_abi_major() -> u32 {
     FFI_ABI_MAJOR
 }
 
+/// Frees the engine. Jobs still queued are cancelled; jobs already
+/// running finish first, so this blocks until every submitted scan has
+/// retired.
 #[no_mangle]
 pub unsafe extern "C" fn dupdupninja_engine_free(engine: *mut DupdupEngine) {
     ok_last_error();
@@ -224,6 +351,379 @@ pub unsafe extern "C" fn dupdupninja_cancel_token_cancel(token: *mut DupdupCance
     (*token).token.cancel();
 }
 
+/// Adjusts the engine's shared resource budget: how many scan jobs may
+/// run at once overall and how many may run against the same drive. A
+/// zero leaves the current value unchanged. Raising a limit wakes
+/// queued jobs immediately; lowering one only affects jobs that have
+/// not started yet.
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_engine_configure(
+    engine: *mut DupdupEngine,
+    max_active_jobs: u32,
+    max_jobs_per_drive: u32,
+) -> DupdupStatus {
+    ok_last_error();
+    if engine.is_null() {
+        set_last_error("engine is null");
+        return DupdupStatus::NullPointer;
+    }
+    let engine = &*(engine as *const Engine);
+    {
+        let mut state = engine.scheduler.state.lock().unwrap();
+        if max_active_jobs > 0 {
+            state.max_active_jobs = max_active_jobs;
+        }
+        if max_jobs_per_drive > 0 {
+            state.max_jobs_per_drive = max_jobs_per_drive;
+        }
+    }
+    engine.scheduler.slot_free.notify_all();
+    DupdupStatus::Ok
+}
+
+/// Submits a scan job (root + database + options) to the engine and
+/// returns immediately with its job id in `out_job_id`. Jobs share the
+/// engine's budgets — see `dupdupninja_engine_configure` — and the
+/// process-wide I/O/CPU pools; jobs on the same drive start in
+/// submission order. `options` may be null for defaults and
+/// `cancel_token` may be null. The progress callback fires on the job's
+/// worker thread, so `user_data` must be safe to touch from there; pass
+/// a distinct `user_data` per job to tell the streams apart. Track
+/// completion with `dupdupninja_engine_job_state`,
+/// `dupdupninja_engine_wait_job`, or `dupdupninja_engine_wait_all`.
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_engine_submit_scan(
+    engine: *mut DupdupEngine,
+    root_path: *const c_char,
+    db_path: *const c_char,
+    options: *const DupdupScanOptions,
+    cancel_token: *mut DupdupCancelToken,
+    progress_cb: DupdupProgressCallback,
+    user_data: *mut libc::c_void,
+    out_job_id: *mut u64,
+) -> DupdupStatus {
+    ok_last_error();
+    if engine.is_null() {
+        set_last_error("engine is null");
+        return DupdupStatus::NullPointer;
+    }
+    if root_path.is_null() {
+        set_last_error("root_path is null");
+        return DupdupStatus::NullPointer;
+    }
+    if db_path.is_null() {
+        set_last_error("db_path is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_job_id.is_null() {
+        set_last_error("out_job_id is null");
+        return DupdupStatus::NullPointer;
+    }
+
+    let root_path = match c_path(root_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e);
+            return DupdupStatus::InvalidArgument;
+        }
+    };
+    let db_path = match c_path(db_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e);
+            return DupdupStatus::InvalidArgument;
+        }
+    };
+
+    let options = if options.is_null() {
+        default_scan_options()
+    } else {
+        *options
+    };
+    let cancel = if cancel_token.is_null() {
+        None
+    } else {
+        Some((*cancel_token).token.clone())
+    };
+
+    let engine = &*(engine as *const Engine);
+    let job_id = engine.next_job_id.fetch_add(1, Ordering::Relaxed) + 1;
+    let drive_key = drive_key_for_root(&root_path);
+    {
+        let mut state = engine.scheduler.state.lock().unwrap();
+        if state.shutdown {
+            set_last_error("engine is shutting down");
+            return DupdupStatus::Error;
+        }
+        state.jobs.insert(
+            job_id,
+            JobRecord {
+                state: DupdupJobState::Queued,
+                error: None,
+                drive_key,
+                seq: job_id,
+            },
+        );
+    }
+
+    let scheduler = Arc::clone(&engine.scheduler);
+    let cfg = scan_config_from_options(root_path, options, true);
+    let callback = JobCallback {
+        progress_cb,
+        user_data,
+    };
+    let worker = match thread::Builder::new()
+        .name(format!("ddn-job-{job_id}"))
+        .spawn(move || run_engine_job(scheduler, job_id, cfg, db_path, cancel, callback))
+    {
+        Ok(worker) => worker,
+        Err(e) => {
+            // Unrecord the job so its id never shows up as Queued.
+            engine.scheduler.state.lock().unwrap().jobs.remove(&job_id);
+            set_last_error(format!("failed to spawn scan job thread: {e}"));
+            return DupdupStatus::Error;
+        }
+    };
+    engine.workers.lock().unwrap().push(worker);
+
+    *out_job_id = job_id;
+    DupdupStatus::Ok
+}
+
+/// Writes the current state of one submitted job to `out_state`. Fails
+/// with `DUPDUP_STATUS_INVALID_ARGUMENT` for an unknown job id.
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_engine_job_state(
+    engine: *mut DupdupEngine,
+    job_id: u64,
+    out_state: *mut DupdupJobState,
+) -> DupdupStatus {
+    ok_last_error();
+    if engine.is_null() {
+        set_last_error("engine is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_state.is_null() {
+        set_last_error("out_state is null");
+        return DupdupStatus::NullPointer;
+    }
+    let engine = &*(engine as *const Engine);
+    let state = engine.scheduler.state.lock().unwrap();
+    match state.jobs.get(&job_id) {
+        Some(job) => {
+            *out_state = job.state;
+            DupdupStatus::Ok
+        }
+        None => {
+            set_last_error("unknown job id");
+            DupdupStatus::InvalidArgument
+        }
+    }
+}
+
+/// Blocks until one job retires. Returns `DUPDUP_STATUS_OK` for a
+/// completed job; a failed or cancelled job returns
+/// `DUPDUP_STATUS_ERROR` with the reason in the last error message,
+/// matching what the blocking scan calls would have returned.
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_engine_wait_job(
+    engine: *mut DupdupEngine,
+    job_id: u64,
+) -> DupdupStatus {
+    ok_last_error();
+    if engine.is_null() {
+        set_last_error("engine is null");
+        return DupdupStatus::NullPointer;
+    }
+    let engine = &*(engine as *const Engine);
+    let mut state = engine.scheduler.state.lock().unwrap();
+    loop {
+        let Some(job) = state.jobs.get(&job_id) else {
+            set_last_error("unknown job id");
+            return DupdupStatus::InvalidArgument;
+        };
+        match job.state {
+            DupdupJobState::Completed => return DupdupStatus::Ok,
+            DupdupJobState::Cancelled => {
+                set_last_error("scan cancelled");
+                return DupdupStatus::Error;
+            }
+            DupdupJobState::Failed => {
+                let msg = job
+                    .error
+                    .clone()
+                    .unwrap_or_else(|| "scan failed".to_string());
+                set_last_error(msg);
+                return DupdupStatus::Error;
+            }
+            DupdupJobState::Queued | DupdupJobState::Running => {
+                state = engine.scheduler.job_done.wait(state).unwrap();
+            }
+        }
+    }
+}
+
+/// Blocks until every submitted job has retired. Returns
+/// `DUPDUP_STATUS_OK` when all completed; otherwise
+/// `DUPDUP_STATUS_ERROR` with a summary in the last error message —
+/// query individual jobs for details.
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_engine_wait_all(engine: *mut DupdupEngine) -> DupdupStatus {
+    ok_last_error();
+    if engine.is_null() {
+        set_last_error("engine is null");
+        return DupdupStatus::NullPointer;
+    }
+    let engine = &*(engine as *const Engine);
+    let mut state = engine.scheduler.state.lock().unwrap();
+    loop {
+        let pending = state
+            .jobs
+            .values()
+            .any(|job| matches!(job.state, DupdupJobState::Queued | DupdupJobState::Running));
+        if !pending {
+            let troubled = state
+                .jobs
+                .values()
+                .filter(|job| {
+                    matches!(
+                        job.state,
+                        DupdupJobState::Failed | DupdupJobState::Cancelled
+                    )
+                })
+                .count();
+            if troubled == 0 {
+                return DupdupStatus::Ok;
+            }
+            set_last_error(format!("{troubled} job(s) failed or were cancelled"));
+            return DupdupStatus::Error;
+        }
+        state = engine.scheduler.job_done.wait(state).unwrap();
+    }
+}
+
+fn run_engine_job(
+    scheduler: Arc<Scheduler>,
+    job_id: u64,
+    cfg: ScanConfig,
+    db_path: PathBuf,
+    cancel: Option<ScanCancelToken>,
+    callback: JobCallback,
+) {
+    // Wait for a slot under both budgets. Per-drive FIFO: a queued job
+    // never overtakes an earlier-submitted queued job on the same drive.
+    {
+        let mut state = scheduler.state.lock().unwrap();
+        loop {
+            if state.shutdown || cancel.as_ref().is_some_and(|t| t.is_cancelled()) {
+                if let Some(job) = state.jobs.get_mut(&job_id) {
+                    job.state = DupdupJobState::Cancelled;
+                }
+                drop(state);
+                scheduler.job_done.notify_all();
+                return;
+            }
+            let (drive_key, seq) = {
+                let job = &state.jobs[&job_id];
+                (job.drive_key.clone(), job.seq)
+            };
+            let drive_running = state
+                .running_per_drive
+                .get(&drive_key)
+                .copied()
+                .unwrap_or(0);
+            let earlier_queued_on_drive = state.jobs.values().any(|job| {
+                job.state == DupdupJobState::Queued && job.drive_key == drive_key && job.seq < seq
+            });
+            if state.running_total < state.max_active_jobs
+                && drive_running < state.max_jobs_per_drive
+                && !earlier_queued_on_drive
+            {
+                state.running_total += 1;
+                *state.running_per_drive.entry(drive_key).or_insert(0) += 1;
+                if let Some(job) = state.jobs.get_mut(&job_id) {
+                    job.state = DupdupJobState::Running;
+                }
+                break;
+            }
+            state = scheduler.slot_free.wait(state).unwrap();
+        }
+    }
+
+    let outcome = SqliteScanStore::open(&db_path).and_then(|store| {
+        scan_to_sqlite_with_progress(&cfg, &store, cancel.as_ref(), |progress| {
+            if let Some(cb) = callback.progress_cb {
+                let path = progress.current_path.to_string_lossy();
+                let c_path =
+                    CString::new(path.as_ref()).unwrap_or_else(|_| CString::new("").unwrap());
+                let c_step = progress
+                    .current_step
+                    .as_deref()
+                    .and_then(|step| CString::new(step).ok());
+                let payload = DupdupProgress {
+                    files_seen: progress.files_seen,
+                    files_hashed: progress.files_hashed,
+                    files_skipped: progress.files_skipped,
+                    bytes_seen: progress.bytes_seen,
+                    total_files: progress.total_files,
+                    total_bytes: progress.total_bytes,
+                    current_path: c_path.as_ptr(),
+                    current_step: c_step
+                        .as_ref()
+                        .map(|s| s.as_ptr())
+                        .unwrap_or(std::ptr::null()),
+                };
+                cb(&payload, callback.user_data);
+            }
+        })
+        .map(|_| ())
+    });
+
+    let (final_state, error) = match outcome {
+        Ok(()) => (DupdupJobState::Completed, None),
+        Err(CoreError::Cancelled) => (DupdupJobState::Cancelled, None),
+        Err(e) => (DupdupJobState::Failed, Some(e.to_string())),
+    };
+    {
+        let mut state = scheduler.state.lock().unwrap();
+        state.running_total -= 1;
+        let drive_key = state.jobs[&job_id].drive_key.clone();
+        if let Some(count) = state.running_per_drive.get_mut(&drive_key) {
+            *count -= 1;
+            if *count == 0 {
+                state.running_per_drive.remove(&drive_key);
+            }
+        }
+        if let Some(job) = state.jobs.get_mut(&job_id) {
+            job.state = final_state;
+            job.error = error;
+        }
+    }
+    scheduler.slot_free.notify_all();
+    scheduler.job_done.notify_all();
+}
+
+/// Groups scan roots by the drive they live on for the per-drive limit.
+/// Prefers the filesystem UUID from drive probing, then the device id,
+/// then the canonical root itself so an unprobeable root still gets a
+/// stable key.
+fn drive_key_for_root(root: &Path) -> String {
+    if let Ok(meta) = dupdupninja_core::drive::probe_for_path(root) {
+        if let Some(id) = meta.id {
+            return format!("uuid:{id}");
+        }
+    }
+    #[cfg(unix)]
+    {
+        use std::os::unix::fs::MetadataExt;
+        if let Ok(meta) = std::fs::metadata(root) {
+            return format!("dev:{}", meta.dev());
+        }
+    }
+    let canonical = std::fs::canonicalize(root).unwrap_or_else(|_| root.to_path_buf());
+    format!("path:{}", canonical.to_string_lossy())
+}
+
 #[no_mangle]
 pub extern "C" fn dupdupninja_last_error_message() -> *const c_char {
     LAST_ERROR.with(|slot| match &*slot.borrow() {
@@ -279,7 +779,10 @@ pub unsafe extern "C" fn dupdupninja_scan_folder_to_sqlite(
     let cfg = scan_config_from_options(root_path, default_scan_options(), true);
 
     match scan_to_sqlite(&cfg, &store) {
-        Ok(_) => DupdupStatus::Ok,
+        Ok(result) => {
+            remember_stage_timings(&result.stats.stage_timings);
+            DupdupStatus::Ok
+        }
         Err(e) => {
             set_last_error(e.to_string());
             DupdupStatus::Error
@@ -368,7 +871,10 @@ pub unsafe extern "C" fn dupdupninja_scan_folder_to_sqlite_with_progress(
     });
 
     match result {
-        Ok(_) => DupdupStatus::Ok,
+        Ok(result) => {
+            remember_stage_timings(&result.stats.stage_timings);
+            DupdupStatus::Ok
+        }
         Err(e) => {
             set_last_error(e.to_string());
             DupdupStatus::Error
@@ -535,7 +1041,10 @@ pub unsafe extern "C" fn dupdupninja_scan_folder_to_sqlite_with_progress_and_tot
     );
 
     match result {
-        Ok(_) => DupdupStatus::Ok,
+        Ok(result) => {
+            remember_stage_timings(&result.stats.stage_timings);
+            DupdupStatus::Ok
+        }
         Err(e) => {
             set_last_error(e.to_string());
             DupdupStatus::Error
@@ -643,7 +1152,10 @@ pub unsafe extern "C" fn dupdupninja_scan_folder_to_sqlite_with_progress_totals_
     );
 
     match result {
-        Ok(_) => DupdupStatus::Ok,
+        Ok(result) => {
+            remember_stage_timings(&result.stats.stage_timings);
+            DupdupStatus::Ok
+        }
         Err(e) => {
             set_last_error(e.to_string());
             DupdupStatus::Error
@@ -651,42 +1163,299 @@ pub unsafe extern "C" fn dupdupninja_scan_folder_to_sqlite_with_progress_totals_
     }
 }
 
+/// Fixed buffer sizes for [`DupdupProgressSnapshot`]; mirrored as enum
+/// constants in the C header. `BOARD_TASK_SLOTS` matches the core board's
+/// table capacity so a snapshot can never truncate the task list.
+const BOARD_TASK_SLOTS: usize = PROGRESS_BOARD_TASK_SLOTS;
+const BOARD_PATH_MAX: usize = 512;
+const BOARD_STEP_MAX: usize = 32;
+
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct DupdupBoardTask {
+    pub path: [c_char; BOARD_PATH_MAX],
+    pub step: [c_char; BOARD_STEP_MAX],
+}
+
+/// Caller-owned copy of the progress board: plain counters plus a fixed
+/// table of in-flight tasks, with no pointers to free. `seq` increases on
+/// every board update, so a host can skip redraws when it is unchanged.
+#[repr(C)]
+pub struct DupdupProgressSnapshot {
+    pub seq: u64,
+    pub files_seen: u64,
+    pub files_hashed: u64,
+    pub files_skipped: u64,
+    pub bytes_seen: u64,
+    pub total_files: u64,
+    pub total_bytes: u64,
+    pub active_len: usize,
+    pub active: [DupdupBoardTask; BOARD_TASK_SLOTS],
+}
+
+/// Opaque shared progress board; see [`dupdupninja_progress_board_new`].
+#[repr(C)]
+pub struct DupdupProgressBoard {
+    _private: [u8; 0],
+}
+
+/// Creates a progress board for use with
+/// `dupdupninja_scan_folder_to_sqlite_with_board`. The board is safe to
+/// read from any thread while a scan publishes into it; keep it alive
+/// until the scan returns, then release with
+/// `dupdupninja_progress_board_free`.
 #[no_mangle]
-pub unsafe extern "C" fn dupdupninja_fileset_list_rows(
-    db_path: *const c_char,
-    duplicates_only: bool,
-    limit: u64,
-    offset: u64,
-    out_rows: *mut *mut DupdupFilesetRow,
-    out_len: *mut usize,
-) -> DupdupStatus {
+pub extern "C" fn dupdupninja_progress_board_new() -> *mut DupdupProgressBoard {
     ok_last_error();
+    let board = Box::new(ScanProgressBoard::new());
+    Box::into_raw(board) as *mut DupdupProgressBoard
+}
 
-    if db_path.is_null() {
-        set_last_error("db_path is null");
-        return DupdupStatus::NullPointer;
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_progress_board_free(board: *mut DupdupProgressBoard) {
+    ok_last_error();
+    if board.is_null() {
+        return;
     }
-    if out_rows.is_null() {
-        set_last_error("out_rows is null");
+    drop(Box::from_raw(board as *mut ScanProgressBoard));
+}
+
+/// Copies the board into `out`. Paths and steps longer than the fixed
+/// buffers are truncated at a character boundary; nothing is allocated
+/// and nothing needs freeing.
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_progress_board_read(
+    board: *const DupdupProgressBoard,
+    out: *mut DupdupProgressSnapshot,
+) -> DupdupStatus {
+    ok_last_error();
+    if board.is_null() {
+        set_last_error("board is null");
         return DupdupStatus::NullPointer;
     }
-    if out_len.is_null() {
-        set_last_error("out_len is null");
+    if out.is_null() {
+        set_last_error("out is null");
         return DupdupStatus::NullPointer;
     }
 
-    let db_path = match c_path(db_path) {
-        Ok(v) => v,
-        Err(e) => {
-            set_last_error(e);
-            return DupdupStatus::InvalidArgument;
-        }
-    };
-    let store = match SqliteScanStore::open(&db_path) {
-        Ok(v) => v,
-        Err(e) => {
-            set_last_error(e.to_string());
-            return DupdupStatus::Error;
+    let board = &*(board as *const ScanProgressBoard);
+    let snapshot = board.read();
+    let out = &mut *out;
+    out.seq = snapshot.seq;
+    out.files_seen = snapshot.files_seen;
+    out.files_hashed = snapshot.files_hashed;
+    out.files_skipped = snapshot.files_skipped;
+    out.bytes_seen = snapshot.bytes_seen;
+    out.total_files = snapshot.total_files;
+    out.total_bytes = snapshot.total_bytes;
+    out.active_len = snapshot.active_tasks.len().min(BOARD_TASK_SLOTS);
+    for (slot, task) in out.active.iter_mut().zip(&snapshot.active_tasks) {
+        copy_truncated_c(&mut slot.path, &task.path.to_string_lossy());
+        copy_truncated_c(&mut slot.step, &task.step);
+    }
+    DupdupStatus::Ok
+}
+
+/// Copies `src` into `dst` as a nul-terminated C string, truncating at a
+/// UTF-8 character boundary when it does not fit.
+fn copy_truncated_c(dst: &mut [c_char], src: &str) {
+    let mut end = src.len().min(dst.len() - 1);
+    while end > 0 && !src.is_char_boundary(end) {
+        end -= 1;
+    }
+    for (out, byte) in dst.iter_mut().zip(&src.as_bytes()[..end]) {
+        *out = *byte as c_char;
+    }
+    dst[end] = 0;
+}
+
+/// Like `dupdupninja_scan_folder_to_sqlite_with_progress_totals_and_options`
+/// but publishes progress into a shared board instead of invoking a
+/// callback per event: the scan updates counters and the active-task table
+/// in place, and the host polls with `dupdupninja_progress_board_read` at
+/// its own frame rate. At high file rates this avoids spending scan CPU on
+/// per-event CString marshalling and active-task list cloning.
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_scan_folder_to_sqlite_with_board(
+    engine: *mut DupdupEngine,
+    root_path: *const c_char,
+    db_path: *const c_char,
+    cancel_token: *mut DupdupCancelToken,
+    total_files: u64,
+    total_bytes: u64,
+    options: *const DupdupScanOptions,
+    board: *mut DupdupProgressBoard,
+) -> DupdupStatus {
+    ok_last_error();
+
+    if engine.is_null() {
+        set_last_error("engine is null");
+        return DupdupStatus::NullPointer;
+    }
+    if root_path.is_null() {
+        set_last_error("root_path is null");
+        return DupdupStatus::NullPointer;
+    }
+    if db_path.is_null() {
+        set_last_error("db_path is null");
+        return DupdupStatus::NullPointer;
+    }
+    if options.is_null() {
+        set_last_error("options is null");
+        return DupdupStatus::NullPointer;
+    }
+    if board.is_null() {
+        set_last_error("board is null");
+        return DupdupStatus::NullPointer;
+    }
+
+    let root_path = match c_path(root_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e);
+            return DupdupStatus::InvalidArgument;
+        }
+    };
+    let db_path = match c_path(db_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e);
+            return DupdupStatus::InvalidArgument;
+        }
+    };
+
+    let store = match SqliteScanStore::open(&db_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e.to_string());
+            return DupdupStatus::Error;
+        }
+    };
+
+    let cfg = scan_config_from_options(root_path, *options, true);
+
+    let cancel_ref = if cancel_token.is_null() {
+        None
+    } else {
+        Some(&(*cancel_token).token)
+    };
+
+    let totals = if total_files == 0 && total_bytes == 0 {
+        None
+    } else {
+        Some(ScanTotals {
+            files: total_files,
+            bytes: total_bytes,
+        })
+    };
+
+    let board = &*(board as *const ScanProgressBoard);
+    let result =
+        scan_to_sqlite_with_progress_totals_and_board(&cfg, &store, cancel_ref, totals, board);
+
+    match result {
+        Ok(result) => {
+            remember_stage_timings(&result.stats.stage_timings);
+            DupdupStatus::Ok
+        }
+        Err(e) => {
+            set_last_error(e.to_string());
+            DupdupStatus::Error
+        }
+    }
+}
+
+/// Fixed width of the stage name field in [`DupdupStageTiming`],
+/// including the nul terminator.
+pub const STAGE_NAME_MAX: usize = 32;
+
+/// Per-stage timing profile of a completed scan. `buckets[i]` counts
+/// calls that took `[2^i, 2^(i+1))` microseconds, with the last bucket
+/// absorbing everything slower.
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct DupdupStageTiming {
+    pub stage: [c_char; STAGE_NAME_MAX],
+    pub calls: u64,
+    pub total_micros: u64,
+    pub buckets: [u64; SCAN_STAGE_BUCKETS],
+}
+
+/// Copies the stage timing profile recorded by the most recent
+/// successful scan call on this thread into a caller-provided array;
+/// `*out_len` receives how many entries were written (at most
+/// `capacity`). Stages that never ran report zero calls. Like
+/// `dupdupninja_last_error_message`, this is per-thread state: call it
+/// from the thread that ran the scan.
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_scan_stage_timings(
+    out_timings: *mut DupdupStageTiming,
+    capacity: usize,
+    out_len: *mut usize,
+) -> DupdupStatus {
+    ok_last_error();
+
+    if out_timings.is_null() {
+        set_last_error("out_timings is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_len.is_null() {
+        set_last_error("out_len is null");
+        return DupdupStatus::NullPointer;
+    }
+
+    LAST_STAGE_TIMINGS.with(|slot| {
+        let timings = slot.borrow();
+        let count = timings.len().min(capacity);
+        for (i, timing) in timings.iter().take(count).enumerate() {
+            let dst = &mut *out_timings.add(i);
+            dst.stage = [0; STAGE_NAME_MAX];
+            copy_truncated_c(&mut dst.stage, timing.stage);
+            dst.calls = timing.calls;
+            dst.total_micros = timing.total_micros;
+            dst.buckets = timing.buckets;
+        }
+        *out_len = count;
+    });
+    DupdupStatus::Ok
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_fileset_list_rows(
+    db_path: *const c_char,
+    duplicates_only: bool,
+    limit: u64,
+    offset: u64,
+    out_rows: *mut *mut DupdupFilesetRow,
+    out_len: *mut usize,
+) -> DupdupStatus {
+    ok_last_error();
+
+    if db_path.is_null() {
+        set_last_error("db_path is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_rows.is_null() {
+        set_last_error("out_rows is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_len.is_null() {
+        set_last_error("out_len is null");
+        return DupdupStatus::NullPointer;
+    }
+
+    let db_path = match c_path(db_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e);
+            return DupdupStatus::InvalidArgument;
+        }
+    };
+    let store = match SqliteScanStore::open(&db_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e.to_string());
+            return DupdupStatus::Error;
         }
     };
 
@@ -793,9 +1562,26 @@ pub unsafe extern "C" fn dupdupninja_fileset_list_similar_groups(
     let phash_threshold = phash_max_distance.clamp(1, 32) as u32;
     let dhash_threshold = dhash_max_distance.clamp(1, 32) as u32;
     let ahash_threshold = ahash_max_distance.clamp(1, 32) as u32;
+
+    // BK-tree candidate generation over phash replaces the old O(n²) sweep;
+    // the dhash/ahash checks below verify candidates exactly as before.
+    let mut phash_tree = BkTree::new();
+    for (idx, row) in rows.iter().enumerate() {
+        if let Some(hash) = row.phash {
+            phash_tree.insert(hash, idx as u32);
+        }
+    }
+
     let mut used = vec![false; rows.len()];
     let mut groups = Vec::new();
     let mut members = Vec::new();
+    let mut hits: Vec<(u32, u32)> = Vec::new();
+    // Scratch structure-of-arrays buffers for batched candidate scoring.
+    let mut cand_idx: Vec<usize> = Vec::new();
+    let mut cand_dhash: Vec<u64> = Vec::new();
+    let mut cand_ahash: Vec<u64> = Vec::new();
+    let mut dhash_dist: Vec<u32> = Vec::new();
+    let mut ahash_dist: Vec<u32> = Vec::new();
 
     for i in 0..rows.len() {
         if used[i] {
@@ -805,25 +1591,41 @@ pub unsafe extern "C" fn dupdupninja_fileset_list_similar_groups(
             continue;
         };
 
-        let mut indices = Vec::new();
-        indices.push(i);
-        for j in (i + 1)..rows.len() {
-            if used[j] {
+        hits.clear();
+        phash_tree.query(base_phash, phash_threshold, &mut hits);
+        let mut candidates: Vec<usize> = hits.iter().map(|&(id, _)| id as usize).collect();
+        candidates.sort_unstable();
+
+        // Gather the candidates' hash columns and score each column with one
+        // batched popcount pass. A missing hash on either side passes the
+        // check, which the gather encodes by substituting the probe value
+        // (distance zero).
+        let base_dhash = rows[i].dhash.unwrap_or(0);
+        let base_ahash = rows[i].ahash.unwrap_or(0);
+        cand_idx.clear();
+        cand_dhash.clear();
+        cand_ahash.clear();
+        for j in candidates {
+            if j <= i || used[j] {
                 continue;
             }
-            let Some(other_phash) = rows[j].phash else {
-                continue;
-            };
-            let dist = hamming64(base_phash, other_phash);
-            let dhash_ok = match (rows[i].dhash, rows[j].dhash) {
-                (Some(a), Some(b)) => hamming64(a, b) <= dhash_threshold,
-                _ => true,
-            };
-            let ahash_ok = match (rows[i].ahash, rows[j].ahash) {
-                (Some(a), Some(b)) => hamming64(a, b) <= ahash_threshold,
-                _ => true,
-            };
-            if dist <= phash_threshold && dhash_ok && ahash_ok {
+            cand_idx.push(j);
+            cand_dhash.push(match (rows[i].dhash, rows[j].dhash) {
+                (Some(_), Some(v)) => v,
+                _ => base_dhash,
+            });
+            cand_ahash.push(match (rows[i].ahash, rows[j].ahash) {
+                (Some(_), Some(v)) => v,
+                _ => base_ahash,
+            });
+        }
+        hamming_batch(base_dhash, &cand_dhash, &mut dhash_dist);
+        hamming_batch(base_ahash, &cand_ahash, &mut ahash_dist);
+
+        let mut indices = Vec::new();
+        indices.push(i);
+        for (k, &j) in cand_idx.iter().enumerate() {
+            if dhash_dist[k] <= dhash_threshold && ahash_dist[k] <= ahash_threshold {
                 indices.push(j);
             }
         }
@@ -892,58 +1694,21 @@ pub unsafe extern "C" fn dupdupninja_fileset_list_similar_groups(
     DupdupStatus::Ok
 }
 
+/// Video-to-video similar groups over snapshot phash sequences.
+///
+/// Candidates come from a BK-tree over every stored snapshot phash and each
+/// pair is verified with the trim-tolerant mean sequence distance from core,
+/// so trimmed or re-encoded copies still group together. `phash_distance` on
+/// each returned row is the rounded mean sequence distance to the group's
+/// first row; dhash/ahash distances do not apply to videos and are reported
+/// as 64. Free the results with the similar groups/rows free functions.
 #[no_mangle]
-pub unsafe extern "C" fn dupdupninja_fileset_rows_free(rows: *mut DupdupFilesetRow, len: usize) {
-    ok_last_error();
-    if rows.is_null() {
-        return;
-    }
-
-    let rows_slice = slice::from_raw_parts_mut(rows, len);
-    for row in rows_slice.iter_mut() {
-        free_owned_c_string(row.path);
-        row.path = std::ptr::null_mut();
-        free_owned_c_string(row.file_type);
-        row.file_type = std::ptr::null_mut();
-        free_owned_c_string(row.blake3_hex);
-        row.blake3_hex = std::ptr::null_mut();
-        free_owned_c_string(row.sha256_hex);
-        row.sha256_hex = std::ptr::null_mut();
-    }
-
-    let _ = Box::from_raw(rows_slice as *mut [DupdupFilesetRow]);
-}
-
-#[no_mangle]
-pub unsafe extern "C" fn dupdupninja_similar_rows_free(rows: *mut DupdupSimilarRow, len: usize) {
-    ok_last_error();
-    if rows.is_null() {
-        return;
-    }
-
-    let rows_slice = slice::from_raw_parts_mut(rows, len);
-    for row in rows_slice.iter_mut() {
-        free_owned_c_string(row.path);
-        row.path = std::ptr::null_mut();
-        free_owned_c_string(row.file_type);
-        row.file_type = std::ptr::null_mut();
-        free_owned_c_string(row.blake3_hex);
-        row.blake3_hex = std::ptr::null_mut();
-        free_owned_c_string(row.sha256_hex);
-        row.sha256_hex = std::ptr::null_mut();
-    }
-
-    let _ = Box::from_raw(rows_slice as *mut [DupdupSimilarRow]);
-}
-
-#[no_mangle]
-pub unsafe extern "C" fn dupdupninja_fileset_list_exact_groups(
+pub unsafe extern "C" fn dupdupninja_fileset_list_video_similar_groups(
     db_path: *const c_char,
-    limit: u64,
-    offset: u64,
-    out_groups: *mut *mut DupdupExactGroup,
+    phash_max_distance: u8,
+    out_groups: *mut *mut DupdupSimilarGroup,
     out_groups_len: *mut usize,
-    out_rows: *mut *mut DupdupFilesetRow,
+    out_rows: *mut *mut DupdupSimilarRow,
     out_rows_len: *mut usize,
 ) -> DupdupStatus {
     ok_last_error();
@@ -984,9 +1749,7 @@ pub unsafe extern "C" fn dupdupninja_fileset_list_exact_groups(
         }
     };
 
-    let limit = (limit.min(10_000)) as usize;
-    let offset = (offset.min(10_000_000)) as usize;
-    let rows = match store.list_files_with_duplicates(limit, offset) {
+    let sequences = match store.list_snapshot_phash_sequences() {
         Ok(v) => v,
         Err(e) => {
             set_last_error(e.to_string());
@@ -994,48 +1757,575 @@ pub unsafe extern "C" fn dupdupninja_fileset_list_exact_groups(
         }
     };
 
-    let mut grouped: BTreeMap<String, Vec<dupdupninja_core::models::FileListRow>> = BTreeMap::new();
-    for row in rows {
-        let group_key = if let Some(hash) = row.blake3.as_ref() {
-            format!("blake3:{}", hash_to_hex_opt(Some(hash)))
-        } else if let Some(hash) = row.sha256.as_ref() {
-            format!("sha256:{}", hash_to_hex_opt(Some(hash)))
-        } else {
-            continue;
-        };
-        grouped.entry(group_key).or_default().push(row);
+    let phash_threshold = phash_max_distance.clamp(1, 32) as u32;
+    let max_mean = phash_threshold as f64;
+
+    let mut tree = BkTree::new();
+    for (idx, (_, hashes)) in sequences.iter().enumerate() {
+        for &hash in hashes {
+            tree.insert(hash, idx as u32);
+        }
     }
 
-    let mut group_records = Vec::new();
-    let mut row_records = Vec::new();
+    // Grouping mirrors the image path: BK-tree candidates, forward-only
+    // anchor sweep, exact verification on the full sequences.
+    let mut used = vec![false; sequences.len()];
+    let mut grouped: Vec<Vec<(usize, f64)>> = Vec::new();
+    let mut hits: Vec<(u32, u32)> = Vec::new();
 
-    for (key, members) in grouped {
-        if members.len() < 2 {
+    for i in 0..sequences.len() {
+        if used[i] {
             continue;
         }
 
-        let rows_start = row_records.len();
-        for row in members {
-            row_records.push(file_list_row_to_ffi(row));
+        hits.clear();
+        for &hash in &sequences[i].1 {
+            tree.query(hash, phash_threshold, &mut hits);
         }
-        let rows_len = row_records.len() - rows_start;
+        let mut candidates: Vec<usize> = hits.iter().map(|&(id, _)| id as usize).collect();
+        candidates.sort_unstable();
+        candidates.dedup();
 
-        let short_hash = key
-            .split_once(':')
-            .map(|(_, h)| h)
-            .unwrap_or("")
-            .chars()
-            .take(12)
-            .collect::<String>();
-        let label = format!("Exact group ({rows_len} files) - {short_hash}");
-        group_records.push(DupdupExactGroup {
+        let mut group = vec![(i, 0.0_f64)];
+        for j in candidates {
+            if j <= i || used[j] {
+                continue;
+            }
+            if let Some(mean) = snapshot_sequence_distance(&sequences[i].1, &sequences[j].1) {
+                if mean <= max_mean {
+                    group.push((j, mean));
+                }
+            }
+        }
+
+        if group.len() < 2 {
+            continue;
+        }
+        for &(idx, _) in &group {
+            used[idx] = true;
+        }
+        grouped.push(group);
+    }
+
+    // Resolve file rows before any C strings are allocated so an error here
+    // cannot leak a half-built result set.
+    let mut records: HashMap<i64, dupdupninja_core::models::MediaFileRecord> = HashMap::new();
+    for group in &grouped {
+        for &(idx, _) in group {
+            let file_id = sequences[idx].0;
+            if records.contains_key(&file_id) {
+                continue;
+            }
+            match store.get_file_by_id(file_id) {
+                Ok(Some(rec)) => {
+                    records.insert(file_id, rec);
+                }
+                Ok(None) => {}
+                Err(e) => {
+                    set_last_error(e.to_string());
+                    return DupdupStatus::Error;
+                }
+            }
+        }
+    }
+
+    let mut groups = Vec::new();
+    let mut members = Vec::new();
+    for group in grouped {
+        let rows_start = members.len();
+        let mut base_name = "(unknown)".to_string();
+        for (k, &(idx, mean)) in group.iter().enumerate() {
+            let Some(rec) = records.get(&sequences[idx].0) else {
+                continue;
+            };
+            if k == 0 {
+                base_name = rec
+                    .path
+                    .file_name()
+                    .and_then(|s| s.to_str())
+                    .unwrap_or("(unknown)")
+                    .to_string();
+            }
+            let phash_distance = mean.round().clamp(0.0, 64.0) as u8;
+            let confidence = similar_confidence_percent(phash_distance as u32);
+            members.push(media_record_to_similar_ffi(rec, phash_distance, confidence));
+        }
+        let rows_len = members.len() - rows_start;
+        if rows_len < 2 {
+            members.truncate(rows_start);
+            continue;
+        }
+        let label = format!("Video similar group ({rows_len} files) - {base_name}");
+        groups.push(DupdupSimilarGroup {
             label: string_to_c_owned(&label),
             rows_start,
             rows_len,
         });
     }
 
-    if group_records.is_empty() {
+    if groups.is_empty() {
+        *out_groups = std::ptr::null_mut();
+        *out_groups_len = 0;
+        *out_rows = std::ptr::null_mut();
+        *out_rows_len = 0;
+        return DupdupStatus::Ok;
+    }
+
+    let mut groups_boxed = groups.into_boxed_slice();
+    let mut rows_boxed = members.into_boxed_slice();
+    *out_groups_len = groups_boxed.len();
+    *out_groups = groups_boxed.as_mut_ptr();
+    *out_rows_len = rows_boxed.len();
+    *out_rows = rows_boxed.as_mut_ptr();
+    std::mem::forget(groups_boxed);
+    std::mem::forget(rows_boxed);
+    DupdupStatus::Ok
+}
+
+/// Row view whose strings point into the arena that returned it; valid
+/// until the arena is freed. Mirrors [`DupdupFilesetRow`] field for field.
+#[repr(C)]
+pub struct DupdupFilesetRowView {
+    pub id: i64,
+    pub path: *const c_char,
+    pub size_bytes: u64,
+    pub file_type: *const c_char,
+    pub blake3_hex: *const c_char,
+    pub sha256_hex: *const c_char,
+}
+
+/// Opaque owner of an arena result set; see
+/// [`dupdupninja_fileset_list_rows_arena`].
+#[repr(C)]
+pub struct DupdupRowArena {
+    _private: [u8; 0],
+}
+
+struct RowArena {
+    /// All row strings, nul-terminated, back to back in one allocation.
+    /// Boxed before the row views are built, so the pointers into it stay
+    /// valid however the arena itself moves.
+    _bytes: Box<[u8]>,
+    rows: Box<[DupdupFilesetRowView]>,
+}
+
+fn push_arena_str(bytes: &mut Vec<u8>, text: &str) -> usize {
+    let start = bytes.len();
+    // An interior NUL would truncate the C view early; strip it, matching
+    // what the CString path degrades to.
+    bytes.extend(text.bytes().filter(|&b| b != 0));
+    bytes.push(0);
+    start
+}
+
+/// Arena-backed variant of `dupdupninja_fileset_list_rows`: the whole
+/// result set lives in two allocations (one string arena, one row array)
+/// instead of four or five CString mallocs per row, and
+/// [`dupdupninja_fileset_rows_arena_free`] releases everything in one
+/// call. Row strings borrow from the arena and die with it.
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_fileset_list_rows_arena(
+    db_path: *const c_char,
+    duplicates_only: u8,
+    limit: u64,
+    offset: u64,
+    out_arena: *mut *mut DupdupRowArena,
+    out_rows: *mut *const DupdupFilesetRowView,
+    out_len: *mut usize,
+) -> DupdupStatus {
+    ok_last_error();
+
+    if db_path.is_null() {
+        set_last_error("db_path is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_arena.is_null() {
+        set_last_error("out_arena is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_rows.is_null() {
+        set_last_error("out_rows is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_len.is_null() {
+        set_last_error("out_len is null");
+        return DupdupStatus::NullPointer;
+    }
+
+    *out_arena = std::ptr::null_mut();
+    *out_rows = std::ptr::null();
+    *out_len = 0;
+
+    let db_path = match c_path(db_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e);
+            return DupdupStatus::InvalidArgument;
+        }
+    };
+    let store = match SqliteScanStore::open(&db_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e.to_string());
+            return DupdupStatus::Error;
+        }
+    };
+
+    let limit = (limit.min(1_000_000)) as usize;
+    let offset = (offset.min(100_000_000)) as usize;
+    let rows = match if duplicates_only != 0 {
+        store.list_files_with_duplicates(limit, offset)
+    } else {
+        store.list_files(limit, offset)
+    } {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e.to_string());
+            return DupdupStatus::Error;
+        }
+    };
+
+    if rows.is_empty() {
+        return DupdupStatus::Ok;
+    }
+
+    // First pass packs every string into one buffer and records offsets;
+    // pointers are only formed once the buffer is boxed and pinned.
+    let mut bytes = Vec::new();
+    let mut packed = Vec::with_capacity(rows.len());
+    for row in rows {
+        let path = push_arena_str(&mut bytes, row.path.to_string_lossy().as_ref());
+        let file_type = push_arena_str(&mut bytes, row.file_type.as_deref().unwrap_or(""));
+        let blake3_hex = push_arena_str(&mut bytes, &hash_to_hex_opt(row.blake3.as_ref()));
+        let sha256_hex = push_arena_str(&mut bytes, &hash_to_hex_opt(row.sha256.as_ref()));
+        packed.push((
+            row.id,
+            row.size_bytes,
+            path,
+            file_type,
+            blake3_hex,
+            sha256_hex,
+        ));
+    }
+
+    let bytes = bytes.into_boxed_slice();
+    let base = bytes.as_ptr() as *const c_char;
+    let views: Vec<DupdupFilesetRowView> = packed
+        .into_iter()
+        .map(
+            |(id, size_bytes, path, file_type, blake3_hex, sha256_hex)| DupdupFilesetRowView {
+                id,
+                path: base.wrapping_add(path),
+                size_bytes,
+                file_type: base.wrapping_add(file_type),
+                blake3_hex: base.wrapping_add(blake3_hex),
+                sha256_hex: base.wrapping_add(sha256_hex),
+            },
+        )
+        .collect();
+
+    let arena = Box::new(RowArena {
+        _bytes: bytes,
+        rows: views.into_boxed_slice(),
+    });
+    *out_rows = arena.rows.as_ptr();
+    *out_len = arena.rows.len();
+    *out_arena = Box::into_raw(arena) as *mut DupdupRowArena;
+    DupdupStatus::Ok
+}
+
+/// Frees an arena result set — rows and every string — in one call.
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_fileset_rows_arena_free(arena: *mut DupdupRowArena) {
+    ok_last_error();
+    if arena.is_null() {
+        return;
+    }
+    drop(Box::from_raw(arena as *mut RowArena));
+}
+
+/// Opaque paged cursor over a fileset's rows; see
+/// [`dupdupninja_fileset_rows_cursor_open`].
+#[repr(C)]
+pub struct DupdupRowCursor {
+    _private: [u8; 0],
+}
+
+struct RowCursor {
+    store: SqliteScanStore,
+    duplicates_only: bool,
+    /// Path of the last row handed out; keyset pagination resumes strictly
+    /// after it, so page cost stays flat however deep the cursor is.
+    last_path: Option<PathBuf>,
+    done: bool,
+}
+
+/// Hard ceiling on rows per page; a virtualized list never needs more and
+/// it bounds the per-call allocation.
+const CURSOR_MAX_PAGE_ROWS: u64 = 10_000;
+
+/// Opens a paged cursor over a fileset's rows in path order.
+///
+/// Unlike `dupdupninja_fileset_list_rows` nothing is materialized up
+/// front: each `..._cursor_next` call fetches one fixed-size page, so a
+/// host virtualizing a 5M-row list only ever pays for the visible window.
+/// Close with `dupdupninja_fileset_rows_cursor_free`.
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_fileset_rows_cursor_open(
+    db_path: *const c_char,
+    duplicates_only: u8,
+    out_cursor: *mut *mut DupdupRowCursor,
+) -> DupdupStatus {
+    ok_last_error();
+
+    if db_path.is_null() {
+        set_last_error("db_path is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_cursor.is_null() {
+        set_last_error("out_cursor is null");
+        return DupdupStatus::NullPointer;
+    }
+
+    let db_path = match c_path(db_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e);
+            return DupdupStatus::InvalidArgument;
+        }
+    };
+    let store = match SqliteScanStore::open(&db_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e.to_string());
+            return DupdupStatus::Error;
+        }
+    };
+
+    let cursor = Box::new(RowCursor {
+        store,
+        duplicates_only: duplicates_only != 0,
+        last_path: None,
+        done: false,
+    });
+    *out_cursor = Box::into_raw(cursor) as *mut DupdupRowCursor;
+    DupdupStatus::Ok
+}
+
+/// Fetches the next page of at most `page_size` rows. Writes an empty page
+/// (null pointer, zero length) once the cursor is exhausted; before that,
+/// free each page with `dupdupninja_fileset_rows_free`.
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_fileset_rows_cursor_next(
+    cursor: *mut DupdupRowCursor,
+    page_size: u64,
+    out_rows: *mut *mut DupdupFilesetRow,
+    out_len: *mut usize,
+) -> DupdupStatus {
+    ok_last_error();
+
+    if cursor.is_null() {
+        set_last_error("cursor is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_rows.is_null() {
+        set_last_error("out_rows is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_len.is_null() {
+        set_last_error("out_len is null");
+        return DupdupStatus::NullPointer;
+    }
+
+    *out_rows = std::ptr::null_mut();
+    *out_len = 0;
+
+    let cursor = &mut *(cursor as *mut RowCursor);
+    if cursor.done {
+        return DupdupStatus::Ok;
+    }
+
+    let page_size = page_size.clamp(1, CURSOR_MAX_PAGE_ROWS) as usize;
+    let rows = match cursor.store.list_files_page(
+        cursor.last_path.as_deref(),
+        page_size,
+        cursor.duplicates_only,
+    ) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e.to_string());
+            return DupdupStatus::Error;
+        }
+    };
+
+    if rows.len() < page_size {
+        cursor.done = true;
+    }
+    if rows.is_empty() {
+        return DupdupStatus::Ok;
+    }
+    cursor.last_path = rows.last().map(|row| row.path.clone());
+
+    let out: Vec<DupdupFilesetRow> = rows.into_iter().map(file_list_row_to_ffi).collect();
+    let mut boxed = out.into_boxed_slice();
+    *out_len = boxed.len();
+    *out_rows = boxed.as_mut_ptr();
+    std::mem::forget(boxed);
+    DupdupStatus::Ok
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_fileset_rows_cursor_free(cursor: *mut DupdupRowCursor) {
+    ok_last_error();
+    if cursor.is_null() {
+        return;
+    }
+    drop(Box::from_raw(cursor as *mut RowCursor));
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_fileset_rows_free(rows: *mut DupdupFilesetRow, len: usize) {
+    ok_last_error();
+    if rows.is_null() {
+        return;
+    }
+
+    let rows_slice = slice::from_raw_parts_mut(rows, len);
+    for row in rows_slice.iter_mut() {
+        free_owned_c_string(row.path);
+        row.path = std::ptr::null_mut();
+        free_owned_c_string(row.file_type);
+        row.file_type = std::ptr::null_mut();
+        free_owned_c_string(row.blake3_hex);
+        row.blake3_hex = std::ptr::null_mut();
+        free_owned_c_string(row.sha256_hex);
+        row.sha256_hex = std::ptr::null_mut();
+    }
+
+    let _ = Box::from_raw(rows_slice as *mut [DupdupFilesetRow]);
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_similar_rows_free(rows: *mut DupdupSimilarRow, len: usize) {
+    ok_last_error();
+    if rows.is_null() {
+        return;
+    }
+
+    let rows_slice = slice::from_raw_parts_mut(rows, len);
+    for row in rows_slice.iter_mut() {
+        free_owned_c_string(row.path);
+        row.path = std::ptr::null_mut();
+        free_owned_c_string(row.file_type);
+        row.file_type = std::ptr::null_mut();
+        free_owned_c_string(row.blake3_hex);
+        row.blake3_hex = std::ptr::null_mut();
+        free_owned_c_string(row.sha256_hex);
+        row.sha256_hex = std::ptr::null_mut();
+    }
+
+    let _ = Box::from_raw(rows_slice as *mut [DupdupSimilarRow]);
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_fileset_list_exact_groups(
+    db_path: *const c_char,
+    limit: u64,
+    offset: u64,
+    out_groups: *mut *mut DupdupExactGroup,
+    out_groups_len: *mut usize,
+    out_rows: *mut *mut DupdupFilesetRow,
+    out_rows_len: *mut usize,
+) -> DupdupStatus {
+    ok_last_error();
+
+    if db_path.is_null() {
+        set_last_error("db_path is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_groups.is_null() {
+        set_last_error("out_groups is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_groups_len.is_null() {
+        set_last_error("out_groups_len is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_rows.is_null() {
+        set_last_error("out_rows is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_rows_len.is_null() {
+        set_last_error("out_rows_len is null");
+        return DupdupStatus::NullPointer;
+    }
+
+    let db_path = match c_path(db_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e);
+            return DupdupStatus::InvalidArgument;
+        }
+    };
+    let store = match SqliteScanStore::open(&db_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e.to_string());
+            return DupdupStatus::Error;
+        }
+    };
+
+    // Grouping is streamed out of SQL one group at a time; limit and
+    // offset apply to whole groups, so a host can page through every
+    // exact group in the fileset without any row cap.
+    let limit = (limit.min(10_000)) as usize;
+    let offset = (offset.min(10_000_000)) as usize;
+
+    let mut group_records = Vec::new();
+    let mut row_records = Vec::new();
+    let mut seen_groups = 0usize;
+
+    let result = store.for_each_exact_duplicate_group(|rows| {
+        let group_idx = seen_groups;
+        seen_groups += 1;
+        if group_idx < offset || group_records.len() >= limit {
+            return;
+        }
+
+        let hash = rows[0].blake3.or(rows[0].sha256);
+        let short_hash = hash_to_hex_opt(hash.as_ref())
+            .chars()
+            .take(12)
+            .collect::<String>();
+
+        let rows_start = row_records.len();
+        for row in rows {
+            row_records.push(file_list_row_to_ffi(row.clone()));
+        }
+        let rows_len = row_records.len() - rows_start;
+
+        let label = format!("Exact group ({rows_len} files) - {short_hash}");
+        group_records.push(DupdupExactGroup {
+            label: string_to_c_owned(&label),
+            rows_start,
+            rows_len,
+        });
+    });
+    if let Err(e) = result {
+        for group in group_records {
+            free_owned_c_string(group.label);
+        }
+        for row in row_records {
+            free_owned_c_string(row.path);
+            free_owned_c_string(row.file_type);
+            free_owned_c_string(row.blake3_hex);
+            free_owned_c_string(row.sha256_hex);
+        }
+        set_last_error(e.to_string());
+        return DupdupStatus::Error;
+    }
+
+    if group_records.is_empty() {
         *out_groups = std::ptr::null_mut();
         *out_groups_len = 0;
         *out_rows = std::ptr::null_mut();
@@ -1223,33 +2513,239 @@ pub unsafe extern "C" fn dupdupninja_fileset_set_metadata(
 }
 
 #[no_mangle]
-pub unsafe extern "C" fn dupdupninja_fileset_metadata_free(meta: *mut DupdupFilesetMetadataView) {
+pub unsafe extern "C" fn dupdupninja_fileset_metadata_free(meta: *mut DupdupFilesetMetadataView) {
+    ok_last_error();
+    if meta.is_null() {
+        return;
+    }
+    free_owned_c_string((*meta).name);
+    (*meta).name = std::ptr::null_mut();
+    free_owned_c_string((*meta).description);
+    (*meta).description = std::ptr::null_mut();
+    free_owned_c_string((*meta).notes);
+    (*meta).notes = std::ptr::null_mut();
+    free_owned_c_string((*meta).status);
+    (*meta).status = std::ptr::null_mut();
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_fileset_delete_file_by_path(
+    db_path: *const c_char,
+    file_path: *const c_char,
+) -> DupdupStatus {
+    ok_last_error();
+    if db_path.is_null() {
+        set_last_error("db_path is null");
+        return DupdupStatus::NullPointer;
+    }
+    if file_path.is_null() {
+        set_last_error("file_path is null");
+        return DupdupStatus::NullPointer;
+    }
+
+    let db_path = match c_path(db_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e);
+            return DupdupStatus::InvalidArgument;
+        }
+    };
+    let file_path = match c_path(file_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e);
+            return DupdupStatus::InvalidArgument;
+        }
+    };
+
+    let store = match SqliteScanStore::open(&db_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e.to_string());
+            return DupdupStatus::Error;
+        }
+    };
+    match store.delete_file_by_path(&file_path) {
+        Ok(_) => DupdupStatus::Ok,
+        Err(e) => {
+            set_last_error(e.to_string());
+            DupdupStatus::Error
+        }
+    }
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_fileset_list_snapshots_by_path(
+    db_path: *const c_char,
+    file_path: *const c_char,
+    out_rows: *mut *mut DupdupSnapshotInfo,
+    out_len: *mut usize,
+) -> DupdupStatus {
+    ok_last_error();
+    if db_path.is_null() {
+        set_last_error("db_path is null");
+        return DupdupStatus::NullPointer;
+    }
+    if file_path.is_null() {
+        set_last_error("file_path is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_rows.is_null() {
+        set_last_error("out_rows is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_len.is_null() {
+        set_last_error("out_len is null");
+        return DupdupStatus::NullPointer;
+    }
+
+    let db_path = match c_path(db_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e);
+            return DupdupStatus::InvalidArgument;
+        }
+    };
+    let file_path = match c_path(file_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e);
+            return DupdupStatus::InvalidArgument;
+        }
+    };
+
+    let store = match SqliteScanStore::open(&db_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e.to_string());
+            return DupdupStatus::Error;
+        }
+    };
+
+    let file = match store.get_file_by_path(&file_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e.to_string());
+            return DupdupStatus::Error;
+        }
+    };
+    let Some(file) = file else {
+        *out_rows = std::ptr::null_mut();
+        *out_len = 0;
+        return DupdupStatus::Ok;
+    };
+    let Some(file_id) = file.file_id else {
+        *out_rows = std::ptr::null_mut();
+        *out_len = 0;
+        return DupdupStatus::Ok;
+    };
+
+    let snapshots = match store.list_file_snapshots(file_id) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e.to_string());
+            return DupdupStatus::Error;
+        }
+    };
+
+    if snapshots.is_empty() {
+        *out_rows = std::ptr::null_mut();
+        *out_len = 0;
+        return DupdupStatus::Ok;
+    }
+
+    let mut out = Vec::with_capacity(snapshots.len());
+    for snap in snapshots {
+        out.push(DupdupSnapshotInfo {
+            snapshot_index: snap.snapshot_index,
+            snapshot_count: snap.snapshot_count,
+            at_ms: snap.at_ms,
+            has_duration: if snap.duration_ms.is_some() { 1 } else { 0 },
+            duration_ms: snap.duration_ms.unwrap_or_default(),
+            has_ahash: if snap.ahash.is_some() { 1 } else { 0 },
+            ahash: snap.ahash.unwrap_or_default(),
+            has_dhash: if snap.dhash.is_some() { 1 } else { 0 },
+            dhash: snap.dhash.unwrap_or_default(),
+            has_phash: if snap.phash.is_some() { 1 } else { 0 },
+            phash: snap.phash.unwrap_or_default(),
+        });
+    }
+
+    let mut boxed = out.into_boxed_slice();
+    *out_len = boxed.len();
+    *out_rows = boxed.as_mut_ptr();
+    std::mem::forget(boxed);
+    DupdupStatus::Ok
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_snapshots_info_free(
+    rows: *mut DupdupSnapshotInfo,
+    len: usize,
+) {
     ok_last_error();
-    if meta.is_null() {
+    if rows.is_null() {
         return;
     }
-    free_owned_c_string((*meta).name);
-    (*meta).name = std::ptr::null_mut();
-    free_owned_c_string((*meta).description);
-    (*meta).description = std::ptr::null_mut();
-    free_owned_c_string((*meta).notes);
-    (*meta).notes = std::ptr::null_mut();
-    free_owned_c_string((*meta).status);
-    (*meta).status = std::ptr::null_mut();
+    let rows_slice = slice::from_raw_parts_mut(rows, len);
+    let _ = Box::from_raw(rows_slice as *mut [DupdupSnapshotInfo]);
+}
+
+#[repr(C)]
+pub struct DupdupCompareRow {
+    pub path: *mut c_char,
+    pub size_bytes: u64,
+    pub file_type: *mut c_char,
+    /// Non-zero when a row with different bytes but an identical phash
+    /// exists on the other side.
+    pub phash_match: u8,
+}
+
+#[repr(C)]
+pub struct DupdupCompareSummary {
+    pub self_label: *mut c_char,
+    pub other_label: *mut c_char,
+    pub matched_files: u64,
+    pub self_unhashed: u64,
+    pub other_unhashed: u64,
 }
 
+/// Compares two scan databases by content hash. The other database is
+/// attached inside SQLite, so the diff never round-trips rows through the
+/// host: `out_self_rows` receives files only in `db_path`,
+/// `out_other_rows` files only in `other_db_path`, each with a flag for
+/// rows whose perceptual hash still matches across sides. Free the row
+/// arrays with `dupdupninja_compare_rows_free` and the summary's strings
+/// with `dupdupninja_compare_summary_free`.
 #[no_mangle]
-pub unsafe extern "C" fn dupdupninja_fileset_delete_file_by_path(
+pub unsafe extern "C" fn dupdupninja_fileset_compare(
     db_path: *const c_char,
-    file_path: *const c_char,
+    other_db_path: *const c_char,
+    out_summary: *mut DupdupCompareSummary,
+    out_self_rows: *mut *mut DupdupCompareRow,
+    out_self_len: *mut usize,
+    out_other_rows: *mut *mut DupdupCompareRow,
+    out_other_len: *mut usize,
 ) -> DupdupStatus {
     ok_last_error();
     if db_path.is_null() {
         set_last_error("db_path is null");
         return DupdupStatus::NullPointer;
     }
-    if file_path.is_null() {
-        set_last_error("file_path is null");
+    if other_db_path.is_null() {
+        set_last_error("other_db_path is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_summary.is_null() {
+        set_last_error("out_summary is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_self_rows.is_null() || out_self_len.is_null() {
+        set_last_error("out_self_rows/out_self_len is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_other_rows.is_null() || out_other_len.is_null() {
+        set_last_error("out_other_rows/out_other_len is null");
         return DupdupStatus::NullPointer;
     }
 
@@ -1260,7 +2756,7 @@ pub unsafe extern "C" fn dupdupninja_fileset_delete_file_by_path(
             return DupdupStatus::InvalidArgument;
         }
     };
-    let file_path = match c_path(file_path) {
+    let other_db_path = match c_path(other_db_path) {
         Ok(v) => v,
         Err(e) => {
             set_last_error(e);
@@ -1275,21 +2771,119 @@ pub unsafe extern "C" fn dupdupninja_fileset_delete_file_by_path(
             return DupdupStatus::Error;
         }
     };
-    match store.delete_file_by_path(&file_path) {
-        Ok(_) => DupdupStatus::Ok,
+    let comparison = match store.compare_with_fileset(&other_db_path) {
+        Ok(v) => v,
         Err(e) => {
             set_last_error(e.to_string());
-            DupdupStatus::Error
+            return DupdupStatus::Error;
         }
+    };
+
+    let to_ffi_rows = |rows: &[dupdupninja_core::models::FilesetDiffRow]| {
+        rows.iter()
+            .map(|row| DupdupCompareRow {
+                path: string_to_c_owned(&row.path.to_string_lossy()),
+                size_bytes: row.size_bytes,
+                file_type: row
+                    .file_type
+                    .as_deref()
+                    .map(string_to_c_owned)
+                    .unwrap_or(std::ptr::null_mut()),
+                phash_match: if row.phash_match { 1 } else { 0 },
+            })
+            .collect::<Vec<_>>()
+    };
+
+    *out_summary = DupdupCompareSummary {
+        self_label: string_to_c_owned(&comparison.self_label),
+        other_label: string_to_c_owned(&comparison.other_label),
+        matched_files: comparison.matched_files,
+        self_unhashed: comparison.self_unhashed,
+        other_unhashed: comparison.other_unhashed,
+    };
+
+    let mut self_boxed = to_ffi_rows(&comparison.only_in_self).into_boxed_slice();
+    *out_self_len = self_boxed.len();
+    *out_self_rows = if self_boxed.is_empty() {
+        std::ptr::null_mut()
+    } else {
+        self_boxed.as_mut_ptr()
+    };
+    if !self_boxed.is_empty() {
+        std::mem::forget(self_boxed);
+    }
+
+    let mut other_boxed = to_ffi_rows(&comparison.only_in_other).into_boxed_slice();
+    *out_other_len = other_boxed.len();
+    *out_other_rows = if other_boxed.is_empty() {
+        std::ptr::null_mut()
+    } else {
+        other_boxed.as_mut_ptr()
+    };
+    if !other_boxed.is_empty() {
+        std::mem::forget(other_boxed);
     }
+
+    DupdupStatus::Ok
 }
 
 #[no_mangle]
-pub unsafe extern "C" fn dupdupninja_fileset_list_snapshots_by_path(
+pub unsafe extern "C" fn dupdupninja_compare_rows_free(rows: *mut DupdupCompareRow, len: usize) {
+    ok_last_error();
+    if rows.is_null() {
+        return;
+    }
+    let rows_slice = slice::from_raw_parts_mut(rows, len);
+    for row in rows_slice.iter_mut() {
+        free_owned_c_string(row.path);
+        row.path = std::ptr::null_mut();
+        free_owned_c_string(row.file_type);
+        row.file_type = std::ptr::null_mut();
+    }
+    let _ = Box::from_raw(rows_slice as *mut [DupdupCompareRow]);
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_compare_summary_free(summary: *mut DupdupCompareSummary) {
+    ok_last_error();
+    if summary.is_null() {
+        return;
+    }
+    let summary = &mut *summary;
+    free_owned_c_string(summary.self_label);
+    summary.self_label = std::ptr::null_mut();
+    free_owned_c_string(summary.other_label);
+    summary.other_label = std::ptr::null_mut();
+}
+
+/// Opaque handle to one snapshot's AVIF blob; see
+/// [`dupdupninja_snapshot_blob_open`].
+#[repr(C)]
+pub struct DupdupSnapshotBlob {
+    _private: [u8; 0],
+}
+
+struct SnapshotBlob {
+    store: SqliteScanStore,
+    rowid: i64,
+}
+
+/// Opens a read handle to one snapshot's AVIF blob.
+///
+/// Unlike `dupdupninja_fileset_list_snapshots_by_path` nothing is copied at
+/// open time: reads go through SQLite's incremental blob I/O straight into
+/// the caller's buffer, so a host can fetch a single thumbnail — or stream
+/// a large blob in chunks — without the library allocating per-blob
+/// buffers. Writes the blob's total byte length to `out_len`. Fails with
+/// `DUPDUP_STATUS_INVALID_ARGUMENT` when the file or snapshot does not
+/// exist. Close with `dupdupninja_snapshot_blob_free`.
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_snapshot_blob_open(
     db_path: *const c_char,
     file_path: *const c_char,
-    out_rows: *mut *mut DupdupSnapshotInfo,
-    out_len: *mut usize,
+    snapshot_index: u32,
+    out_blob: *mut *mut DupdupSnapshotBlob,
+    out_len: *mut u64,
 ) -> DupdupStatus {
     ok_last_error();
     if db_path.is_null() {
@@ -1300,8 +2894,8 @@ pub unsafe extern "C" fn dupdupninja_fileset_list_snapshots_by_path(
         set_last_error("file_path is null");
         return DupdupStatus::NullPointer;
     }
-    if out_rows.is_null() {
-        set_last_error("out_rows is null");
+    if out_blob.is_null() {
+        set_last_error("out_blob is null");
         return DupdupStatus::NullPointer;
     }
     if out_len.is_null() {
@@ -1339,66 +2933,272 @@ pub unsafe extern "C" fn dupdupninja_fileset_list_snapshots_by_path(
             return DupdupStatus::Error;
         }
     };
-    let Some(file) = file else {
-        *out_rows = std::ptr::null_mut();
-        *out_len = 0;
-        return DupdupStatus::Ok;
-    };
-    let Some(file_id) = file.file_id else {
-        *out_rows = std::ptr::null_mut();
-        *out_len = 0;
-        return DupdupStatus::Ok;
+    let Some(file_id) = file.and_then(|f| f.file_id) else {
+        set_last_error("file not found in fileset");
+        return DupdupStatus::InvalidArgument;
     };
 
-    let snapshots = match store.list_file_snapshots(file_id) {
+    let located = match store.locate_snapshot_blob(file_id, snapshot_index) {
         Ok(v) => v,
         Err(e) => {
             set_last_error(e.to_string());
             return DupdupStatus::Error;
         }
     };
+    let Some((rowid, len)) = located else {
+        set_last_error("snapshot not found");
+        return DupdupStatus::InvalidArgument;
+    };
 
-    if snapshots.is_empty() {
-        *out_rows = std::ptr::null_mut();
-        *out_len = 0;
-        return DupdupStatus::Ok;
+    let blob = Box::new(SnapshotBlob { store, rowid });
+    *out_len = len;
+    *out_blob = Box::into_raw(blob) as *mut DupdupSnapshotBlob;
+    DupdupStatus::Ok
+}
+
+/// Reads up to `buf_len` bytes of the blob starting at `offset` into the
+/// caller-provided `buf`. Writes the number of bytes read to `out_read` —
+/// short only at the end of the blob, zero at or past it.
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_snapshot_blob_read(
+    blob: *mut DupdupSnapshotBlob,
+    offset: u64,
+    buf: *mut u8,
+    buf_len: usize,
+    out_read: *mut usize,
+) -> DupdupStatus {
+    ok_last_error();
+    if blob.is_null() {
+        set_last_error("blob is null");
+        return DupdupStatus::NullPointer;
+    }
+    if buf.is_null() {
+        set_last_error("buf is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_read.is_null() {
+        set_last_error("out_read is null");
+        return DupdupStatus::NullPointer;
     }
 
-    let mut out = Vec::with_capacity(snapshots.len());
-    for snap in snapshots {
-        out.push(DupdupSnapshotInfo {
-            snapshot_index: snap.snapshot_index,
-            snapshot_count: snap.snapshot_count,
-            at_ms: snap.at_ms,
-            has_duration: if snap.duration_ms.is_some() { 1 } else { 0 },
-            duration_ms: snap.duration_ms.unwrap_or_default(),
-            has_ahash: if snap.ahash.is_some() { 1 } else { 0 },
-            ahash: snap.ahash.unwrap_or_default(),
-            has_dhash: if snap.dhash.is_some() { 1 } else { 0 },
-            dhash: snap.dhash.unwrap_or_default(),
-            has_phash: if snap.phash.is_some() { 1 } else { 0 },
-            phash: snap.phash.unwrap_or_default(),
-        });
+    *out_read = 0;
+    let blob = &*(blob as *const SnapshotBlob);
+    let dest = slice::from_raw_parts_mut(buf, buf_len);
+    match blob.store.read_snapshot_blob_at(blob.rowid, offset, dest) {
+        Ok(read) => {
+            *out_read = read;
+            DupdupStatus::Ok
+        }
+        Err(e) => {
+            set_last_error(e.to_string());
+            DupdupStatus::Error
+        }
     }
+}
 
-    let mut boxed = out.into_boxed_slice();
-    *out_len = boxed.len();
-    *out_rows = boxed.as_mut_ptr();
-    std::mem::forget(boxed);
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_snapshot_blob_free(blob: *mut DupdupSnapshotBlob) {
+    ok_last_error();
+    if blob.is_null() {
+        return;
+    }
+    drop(Box::from_raw(blob as *mut SnapshotBlob));
+}
+
+/// Opaque decoded-thumbnail cache; see [`dupdupninja_thumbnail_cache_new`].
+#[repr(C)]
+pub struct DupdupThumbnailCache {
+    _private: [u8; 0],
+}
+
+/// Opens a decoded-thumbnail cache over one fileset database with a
+/// pixel-data budget of `capacity_bytes`, and starts its background
+/// decode workers. Hosts keep one cache per list/database and share it
+/// across rows. Close with `dupdupninja_thumbnail_cache_free`.
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_thumbnail_cache_new(
+    db_path: *const c_char,
+    capacity_bytes: u64,
+    out_cache: *mut *mut DupdupThumbnailCache,
+) -> DupdupStatus {
+    ok_last_error();
+    if db_path.is_null() {
+        set_last_error("db_path is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_cache.is_null() {
+        set_last_error("out_cache is null");
+        return DupdupStatus::NullPointer;
+    }
+
+    let db_path = match c_path(db_path) {
+        Ok(v) => v,
+        Err(e) => {
+            set_last_error(e);
+            return DupdupStatus::InvalidArgument;
+        }
+    };
+
+    match ThumbnailCache::open(&db_path, capacity_bytes as usize) {
+        Ok(cache) => {
+            *out_cache = Box::into_raw(Box::new(cache)) as *mut DupdupThumbnailCache;
+            DupdupStatus::Ok
+        }
+        Err(e) => {
+            set_last_error(e.to_string());
+            DupdupStatus::Error
+        }
+    }
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_thumbnail_cache_free(cache: *mut DupdupThumbnailCache) {
+    ok_last_error();
+    if cache.is_null() {
+        return;
+    }
+    drop(Box::from_raw(cache as *mut ThumbnailCache));
+}
+
+/// Queues a background decode for one thumbnail; returns immediately.
+/// Call this for the rows around the viewport as the user scrolls, then
+/// poll `dupdupninja_thumbnail_cache_ready_seq` to learn when results
+/// are worth re-fetching. `max_dim` is the longest output edge in
+/// pixels.
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_thumbnail_cache_request(
+    cache: *mut DupdupThumbnailCache,
+    file_id: i64,
+    snapshot_index: u32,
+    max_dim: u32,
+) -> DupdupStatus {
+    ok_last_error();
+    if cache.is_null() {
+        set_last_error("cache is null");
+        return DupdupStatus::NullPointer;
+    }
+    if max_dim == 0 {
+        set_last_error("max_dim must be at least 1");
+        return DupdupStatus::InvalidArgument;
+    }
+    let cache = &*(cache as *const ThumbnailCache);
+    cache.request(ThumbnailKey {
+        file_id,
+        snapshot_index,
+        max_dim,
+    });
     DupdupStatus::Ok
 }
 
+/// Writes the cache's completion counter to `out_seq`. It increases
+/// every time a background decode finishes, so a host polls it and only
+/// re-fetches thumbnails when the value changed.
 #[no_mangle]
-pub unsafe extern "C" fn dupdupninja_snapshots_info_free(
-    rows: *mut DupdupSnapshotInfo,
-    len: usize,
-) {
+pub unsafe extern "C" fn dupdupninja_thumbnail_cache_ready_seq(
+    cache: *mut DupdupThumbnailCache,
+    out_seq: *mut u64,
+) -> DupdupStatus {
     ok_last_error();
-    if rows.is_null() {
+    if cache.is_null() {
+        set_last_error("cache is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_seq.is_null() {
+        set_last_error("out_seq is null");
+        return DupdupStatus::NullPointer;
+    }
+    let cache = &*(cache as *const ThumbnailCache);
+    *out_seq = cache.ready_seq();
+    DupdupStatus::Ok
+}
+
+/// Fetches one decoded thumbnail as tightly packed RGBA8. On a hit the
+/// pixels are copied into a library-owned buffer the caller frees with
+/// `dupdupninja_thumbnail_rgba_free`. On a miss with `decode_if_missing`
+/// false the call queues a background decode and returns `DUPDUP_STATUS_OK`
+/// with `*out_rgba` null — poll the ready seq and retry; with it true the
+/// call blocks and decodes on this thread. A null `*out_rgba` after a
+/// blocking call means the snapshot does not exist or cannot be decoded.
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_thumbnail_cache_get(
+    cache: *mut DupdupThumbnailCache,
+    file_id: i64,
+    snapshot_index: u32,
+    max_dim: u32,
+    decode_if_missing: bool,
+    out_width: *mut u32,
+    out_height: *mut u32,
+    out_rgba: *mut *mut u8,
+    out_len: *mut usize,
+) -> DupdupStatus {
+    ok_last_error();
+    if cache.is_null() {
+        set_last_error("cache is null");
+        return DupdupStatus::NullPointer;
+    }
+    if out_width.is_null() || out_height.is_null() || out_rgba.is_null() || out_len.is_null() {
+        set_last_error("output pointer is null");
+        return DupdupStatus::NullPointer;
+    }
+    if max_dim == 0 {
+        set_last_error("max_dim must be at least 1");
+        return DupdupStatus::InvalidArgument;
+    }
+
+    *out_width = 0;
+    *out_height = 0;
+    *out_rgba = std::ptr::null_mut();
+    *out_len = 0;
+
+    let cache = &*(cache as *const ThumbnailCache);
+    let key = ThumbnailKey {
+        file_id,
+        snapshot_index,
+        max_dim,
+    };
+    let thumb = if decode_if_missing {
+        match cache.get_or_decode(key) {
+            Ok(v) => v,
+            Err(e) => {
+                set_last_error(e.to_string());
+                return DupdupStatus::Error;
+            }
+        }
+    } else {
+        let hit = cache.get(key);
+        if hit.is_none() {
+            cache.request(key);
+        }
+        hit
+    };
+
+    if let Some(thumb) = thumb {
+        let Thumbnail {
+            width,
+            height,
+            rgba,
+        } = thumb;
+        let owned: Box<[u8]> = rgba.as_ref().into();
+        let len = owned.len();
+        *out_width = width;
+        *out_height = height;
+        *out_len = len;
+        *out_rgba = Box::into_raw(owned) as *mut u8;
+    }
+    DupdupStatus::Ok
+}
+
+/// Frees a pixel buffer returned by `dupdupninja_thumbnail_cache_get`.
+/// `len` must be the length the get call reported.
+#[no_mangle]
+pub unsafe extern "C" fn dupdupninja_thumbnail_rgba_free(rgba: *mut u8, len: usize) {
+    ok_last_error();
+    if rgba.is_null() {
         return;
     }
-    let rows_slice = slice::from_raw_parts_mut(rows, len);
-    let _ = Box::from_raw(rows_slice as *mut [DupdupSnapshotInfo]);
+    drop(Box::from_raw(
+        slice::from_raw_parts_mut(rgba, len) as *mut [u8]
+    ));
 }
 
 unsafe fn c_path(ptr: *const c_char) -> Result<PathBuf, String> {
@@ -1441,6 +3241,10 @@ fn scan_config_from_options(
         snapshots_per_video: options.snapshots_per_video.clamp(1, 10),
         snapshot_max_dim: options.snapshot_max_dim.clamp(128, 4096),
         concurrent_processing: options.concurrent_processing,
+        hash_io_backend: dupdupninja_core::hash::HashIoBackend::Auto,
+        lazy_hashing: false,
+        drop_behind_cache: false,
+        incremental: false,
     }
 }
 
@@ -1483,8 +3287,23 @@ fn file_list_row_to_similar_ffi(
     }
 }
 
-fn hamming64(a: u64, b: u64) -> u32 {
-    (a ^ b).count_ones()
+fn media_record_to_similar_ffi(
+    rec: &dupdupninja_core::models::MediaFileRecord,
+    phash_distance: u8,
+    confidence_percent: f32,
+) -> DupdupSimilarRow {
+    DupdupSimilarRow {
+        id: rec.file_id.unwrap_or_default(),
+        path: string_to_c_owned(rec.path.to_string_lossy().as_ref()),
+        size_bytes: rec.size_bytes,
+        file_type: string_to_c_owned(rec.file_type.as_deref().unwrap_or("")),
+        blake3_hex: string_to_c_owned(&hash_to_hex_opt(rec.blake3.as_ref())),
+        sha256_hex: string_to_c_owned(&hash_to_hex_opt(rec.sha256.as_ref())),
+        phash_distance,
+        dhash_distance: 64,
+        ahash_distance: 64,
+        confidence_percent,
+    }
 }
 
 fn similar_confidence_percent(phash_distance: u32) -> f32 {
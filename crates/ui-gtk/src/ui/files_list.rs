@@ -8,6 +8,7 @@ use gtk::prelude::GtkWindowExt;
 use gtk4 as gtk;
 
 use dupdupninja_core::models::{FileListRow, FileSnapshotRecord};
+use dupdupninja_core::thumbs::{ThumbnailCache, ThumbnailKey};
 use dupdupninja_core::MediaFileRecord;
 use image::ImageFormat;
 
@@ -826,6 +827,15 @@ fn update_status(
     }
 }
 
+/// Pixel-data budget for the compare window's decoded-thumbnail cache.
+/// Enough for a few hundred 1024px thumbnails, so flipping between tabs
+/// never re-decodes.
+const COMPARE_THUMBNAIL_CACHE_BYTES: usize = 128 * 1024 * 1024;
+
+/// Longest edge of the decoded compare thumbnails; matches the default
+/// snapshot capture dimension, so decode never upscales.
+const COMPARE_THUMBNAIL_MAX_DIM: u32 = 1024;
+
 fn open_compare_window(ui_state: &Rc<RefCell<Option<UiState>>>) {
     let (db_path, root_path, selections) = {
         let state_ref = ui_state.borrow();
@@ -867,6 +877,14 @@ fn open_compare_window(ui_state: &Rc<RefCell<Option<UiState>>>) {
         }
     };
 
+    // Shared decoded-thumbnail cache; its workers start decoding as soon
+    // as keys are prefetched below, while the window is still being
+    // built. A failure here only costs the cache — snapshot_widget falls
+    // back to decoding blobs inline.
+    let thumb_cache = ThumbnailCache::open(&db_path, COMPARE_THUMBNAIL_CACHE_BYTES)
+        .map(Rc::new)
+        .ok();
+
     let notebook = gtk::Notebook::new();
     notebook.set_hexpand(true);
     notebook.set_vexpand(true);
@@ -899,7 +917,16 @@ fn open_compare_window(ui_state: &Rc<RefCell<Option<UiState>>>) {
             .map(|f| f.snapshots.len())
             .max()
             .unwrap_or(0);
-        let tab = build_compare_tab(&root_path, &parent_file, &match_records, max_snapshots);
+        if let Some(cache) = thumb_cache.as_deref() {
+            prefetch_compare_thumbnails(cache, &parent_file, &match_records);
+        }
+        let tab = build_compare_tab(
+            &root_path,
+            &parent_file,
+            &match_records,
+            max_snapshots,
+            thumb_cache.as_deref(),
+        );
         let tab_label = gtk::Label::new(Some(&tab_title));
         notebook.append_page(&tab, Some(&tab_label));
     }
@@ -971,20 +998,41 @@ struct CompareFile {
     snapshots: Vec<FileSnapshotRecord>,
 }
 
+/// Queues background decodes for every snapshot in one compare tab, so
+/// the cache workers warm up while the widgets are still being built.
+fn prefetch_compare_thumbnails(
+    cache: &ThumbnailCache,
+    parent: &CompareFile,
+    matches: &[CompareFile],
+) {
+    for file in std::iter::once(parent).chain(matches.iter()) {
+        let Some(file_id) = file.record.file_id else {
+            continue;
+        };
+        cache.prefetch(file.snapshots.iter().map(|snapshot| ThumbnailKey {
+            file_id,
+            snapshot_index: snapshot.snapshot_index,
+            max_dim: COMPARE_THUMBNAIL_MAX_DIM,
+        }));
+    }
+}
+
 fn build_compare_tab(
     root_path: &Path,
     parent: &CompareFile,
     matches: &[CompareFile],
     max_snapshots: usize,
+    thumb_cache: Option<&ThumbnailCache>,
 ) -> gtk::Widget {
     let rows = metadata_rows(max_snapshots);
     let parent_title = format!("Parent: {}", display_name(&parent.record));
-    let parent_column = build_metadata_column(&parent_title, &rows, parent, root_path, true);
+    let parent_column =
+        build_metadata_column(&parent_title, &rows, parent, root_path, true, thumb_cache);
 
     let matches_box = gtk::Box::new(gtk::Orientation::Horizontal, 16);
     for file in matches {
         let title = display_name(&file.record);
-        let column = build_metadata_column(&title, &rows, file, root_path, false);
+        let column = build_metadata_column(&title, &rows, file, root_path, false, thumb_cache);
         matches_box.append(&column);
     }
 
@@ -1024,6 +1072,7 @@ fn build_metadata_column(
     file: &CompareFile,
     root_path: &Path,
     include_labels: bool,
+    thumb_cache: Option<&ThumbnailCache>,
 ) -> gtk::Widget {
     let column = gtk::Box::new(gtk::Orientation::Vertical, 8);
     column.set_margin_top(12);
@@ -1060,7 +1109,7 @@ fn build_metadata_column(
                 row.append(&value_label);
             }
             CompareRow::Snapshot(index) => {
-                row.append(&snapshot_widget(&file.snapshots, *index));
+                row.append(&snapshot_widget(file, *index, thumb_cache));
             }
         }
         column.append(&row);
@@ -1105,8 +1154,22 @@ fn snapshot_label(index: usize) -> String {
     format!("Snapshot {}", index + 1)
 }
 
-fn snapshot_widget(snapshots: &[FileSnapshotRecord], index: usize) -> gtk::Widget {
-    if let Some(snapshot) = snapshots.get(index) {
+fn snapshot_widget(
+    file: &CompareFile,
+    index: usize,
+    thumb_cache: Option<&ThumbnailCache>,
+) -> gtk::Widget {
+    if let Some(snapshot) = file.snapshots.get(index) {
+        // Cache first: on a repeat view this is a pointer copy into a
+        // texture, and the prefetch issued when the window opened has
+        // usually decoded it already.
+        if let Some(texture) = cached_snapshot_texture(thumb_cache, file, snapshot) {
+            let picture = gtk::Picture::for_paintable(&texture);
+            picture.set_can_shrink(false);
+            picture.set_content_fit(gtk::ContentFit::Contain);
+            picture.set_size_request(160, 90);
+            return picture.upcast();
+        }
         let bytes = gtk::glib::Bytes::from(&snapshot.image_avif);
         if let Ok(texture) = gtk::gdk::Texture::from_bytes(&bytes) {
             let picture = gtk::Picture::for_paintable(&texture);
@@ -1169,6 +1232,37 @@ fn load_snapshots(
     store.list_file_snapshots(file_id).unwrap_or_default()
 }
 
+/// Builds a texture from the shared decoded-thumbnail cache, waiting for
+/// an in-flight prefetch or decoding inline on a cold miss. `None` means
+/// no cache or the cache could not decode it; the caller falls back to
+/// the blob paths.
+fn cached_snapshot_texture(
+    thumb_cache: Option<&ThumbnailCache>,
+    file: &CompareFile,
+    snapshot: &FileSnapshotRecord,
+) -> Option<gtk::gdk::Texture> {
+    let cache = thumb_cache?;
+    let file_id = file.record.file_id?;
+    let thumb = cache
+        .get_or_decode(ThumbnailKey {
+            file_id,
+            snapshot_index: snapshot.snapshot_index,
+            max_dim: COMPARE_THUMBNAIL_MAX_DIM,
+        })
+        .ok()
+        .flatten()?;
+    let stride = (thumb.width as usize).saturating_mul(4);
+    let bytes = gtk::glib::Bytes::from(thumb.rgba.as_ref());
+    let texture = gtk::gdk::MemoryTexture::new(
+        thumb.width as i32,
+        thumb.height as i32,
+        gtk::gdk::MemoryFormat::R8g8b8a8,
+        &bytes,
+        stride,
+    );
+    Some(texture.upcast::<gtk::gdk::Texture>())
+}
+
 fn decode_avif_texture(data: &[u8]) -> Option<gtk::gdk::Texture> {
     let img = image::load_from_memory_with_format(data, ImageFormat::Avif).ok()?;
     let rgba = img.to_rgba8();